@@ -0,0 +1,811 @@
+/**
+ * @file vg_lite_bench.cpp
+ *
+ * Micro benchmarks of the software paths of vg_lite_tvg.cpp, the source of
+ * the numbers quoted in the commit history.
+ *
+ * Build on the host, vg_lite_tvg.cpp is included to reach its static kernels:
+ *   cc -O2 -ffp-contract=off -I.. -c ../vg_lite_matrix.c
+ *   c++ -O2 -ffp-contract=off -std=c++14 -I.. -I<thorvg>/inc -o vg_lite_bench vg_lite_bench.cpp vg_lite_matrix.o -lthorvg
+ *
+ * Usage:
+ *   vg_lite_bench [case...]
+ *
+ * Without arguments every case runs. Timings are the best of BENCH_REPEAT
+ * runs, so they show the kernels with warm caches.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "../vg_lite_tvg.cpp"
+#include <chrono>
+#include <stdio.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define BENCH_REPEAT 5
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const char* name;
+    void (*run)(void);
+} bench_case_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static void bench_transform_matrix(void);
+static void bench_warp(void);
+static void bench_transform_points(void);
+static void bench_color_key(void);
+static void bench_dither(void);
+static void bench_rotate(void);
+static void bench_quality(void);
+static void bench_linear_grad(void);
+static void bench_gaussian(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static const bench_case_t bench_cases[] = {
+    { "transform_matrix", bench_transform_matrix },
+    { "warp", bench_warp },
+    { "transform_points", bench_transform_points },
+    { "color_key", bench_color_key },
+    { "dither", bench_dither },
+    { "rotate", bench_rotate },
+    { "quality", bench_quality },
+    { "linear_grad", bench_linear_grad },
+    { "gaussian", bench_gaussian },
+};
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(int argc, char* argv[])
+{
+    for (const auto& bench : bench_cases) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            selected |= strcmp(argv[i], bench.name) == 0;
+        }
+
+        if (selected) {
+            printf("%s\n", bench.name);
+            bench.run();
+        }
+    }
+
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/* Nanoseconds per call of (fn), best of BENCH_REPEAT runs of (loops) calls. */
+template <typename F>
+static double bench_time(uint32_t loops, F fn)
+{
+    double best = 0;
+    for (int run = 0; run < BENCH_REPEAT; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < loops; i++) {
+            fn(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / loops;
+        best = run == 0 ? ns : MIN(best, ns);
+    }
+    return best;
+}
+
+static void bench_buffer(vg_lite_buffer_t* buffer, uint32_t width, uint32_t height, vg_lite_buffer_format_t format)
+{
+    memset(buffer, 0, sizeof(vg_lite_buffer_t));
+    buffer->width = width;
+    buffer->height = height;
+    buffer->format = format;
+    vg_lite_allocate(buffer);
+
+    /* some structure, so the kernels can't shortcut flat or zero pixels */
+    uint8_t* bytes = (uint8_t*)buffer->memory;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < (uint32_t)buffer->stride; x++) {
+            bytes[y * buffer->stride + x] = (uint8_t)(x * 7 + y * 5 + ((x ^ y) & 0x3f));
+        }
+    }
+}
+
+static void bench_report(const char* label, double ns, uint32_t pixels)
+{
+    if (pixels) {
+        printf("  %-36s %10.3f ms %8.1f Mpx/s\n", label, ns / 1e6, pixels * 1e3 / ns);
+    } else {
+        printf("  %-36s %10.2f ns\n", label, ns);
+    }
+}
+
+/* The resolve of vg_lite_finish() from the canvas (src) to all of a (target),
+ * turned by (quarter) clockwise quarter turns.
+ */
+static void bench_resolve(picture_resolve_t* resolve, const uint32_t* src, const vg_lite_buffer_t* target, uint32_t quarter)
+{
+    uint32_t width = target->width;
+    memset(resolve, 0, sizeof(picture_resolve_t));
+    resolve->src = src;
+    resolve->width = width;
+    resolve->height = target->height;
+    resolve->quarter = quarter;
+    resolve->stride = target->stride;
+    resolve->x1 = width;
+    resolve->y1 = target->height;
+    resolve->band = vg_lite_ctx::get_instance()->get_resolve_band(width);
+    resolve->line = resolve->band + width * PICTURE_RESOLVE_BAND;
+}
+
+/* Largest distance of the mapped (src) corners from the (dst) corners. */
+static double bench_corner_error(const vg_lite_matrix_t* matrix, vg_lite_point4_t src, vg_lite_point4_t dst)
+{
+    double error = 0;
+    for (int k = 0; k < 4; k++) {
+        double x = src[k].x;
+        double y = src[k].y;
+        double w = matrix->m[2][0] * x + matrix->m[2][1] * y + matrix->m[2][2];
+        error = MAX(error, fabs((matrix->m[0][0] * x + matrix->m[0][1] * y + matrix->m[0][2]) / w - dst[k].x));
+        error = MAX(error, fabs((matrix->m[1][0] * x + matrix->m[1][1] * y + matrix->m[1][2]) / w - dst[k].y));
+    }
+    return error;
+}
+
+/* The homography through the four corner pairs as the 8x8 linear system,
+ * solved in long double and rounded to float.
+ */
+static bool bench_exact_matrix(vg_lite_point4_t src, vg_lite_point4_t dst, vg_lite_matrix_t* matrix)
+{
+    long double a[8][9];
+    for (int k = 0; k < 4; k++) {
+        long double x = src[k].x;
+        long double y = src[k].y;
+        long double u = dst[k].x;
+        long double v = dst[k].y;
+        long double row0[9] = { x, y, 1, 0, 0, 0, -u * x, -u * y, u };
+        long double row1[9] = { 0, 0, 0, x, y, 1, -v * x, -v * y, v };
+        memcpy(a[k * 2], row0, sizeof(row0));
+        memcpy(a[k * 2 + 1], row1, sizeof(row1));
+    }
+
+    for (int c = 0; c < 8; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < 8; r++) {
+            if (fabsl(a[r][c]) > fabsl(a[pivot][c])) {
+                pivot = r;
+            }
+        }
+        if (a[pivot][c] == 0) {
+            return false;
+        }
+        for (int k = 0; k < 9; k++) {
+            long double t = a[c][k];
+            a[c][k] = a[pivot][k];
+            a[pivot][k] = t;
+        }
+        for (int r = 0; r < 8; r++) {
+            if (r != c) {
+                long double f = a[r][c] / a[c][c];
+                for (int k = c; k < 9; k++) {
+                    a[r][k] -= f * a[c][k];
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 8; i++) {
+        matrix->m[i / 3][i % 3] = (float)(a[i][8] / a[i][i]);
+    }
+    matrix->m[2][2] = 1.0f;
+    return true;
+}
+
+/* vg_lite_get_transform_matrix(): time per call, and how well the matrix
+ * maps the source corners onto the destination corners for random quads.
+ * Quads close to the horizon can't be mapped exactly by any float matrix,
+ * so the error is compared with the one of the exact solution rounded to
+ * float.
+ */
+static void bench_transform_matrix(void)
+{
+    vg_lite_point4_t src = { { 0, 0 }, { 480, 0 }, { 480, 320 }, { 0, 320 } };
+    vg_lite_point4_t projective = { { 10, 20 }, { 470, 0 }, { 470, 320 }, { 10, 300 } };
+    vg_lite_point4_t affine = { { 10, 20 }, { 490, 20 }, { 490, 340 }, { 10, 340 } };
+    vg_lite_matrix_t matrix;
+    volatile float sink = 0;
+
+    double ns = bench_time(1000000, [&](uint32_t i) {
+        projective[1].x = 470 + (i & 7);
+        vg_lite_get_transform_matrix(src, projective, &matrix);
+        sink = sink + matrix.m[0][0];
+    });
+    bench_report("projective", ns, 0);
+
+    ns = bench_time(1000000, [&](uint32_t i) {
+        affine[1].x = 490 + (i & 7);
+        affine[2].x = 490 + (i & 7);
+        vg_lite_get_transform_matrix(src, affine, &matrix);
+        sink = sink + matrix.m[0][0];
+    });
+    bench_report("parallelogram", ns, 0);
+
+    srand(1);
+    double error = 0;
+    double exact_error = 0;
+    double excess = 0;
+    uint32_t solved = 0;
+    for (int n = 0; n < 200000; n++) {
+        vg_lite_point4_t s, d;
+        int32_t w = 1 + rand() % 800;
+        int32_t h = 1 + rand() % 600;
+        int32_t x = rand() % 1000 - 200;
+        int32_t y = rand() % 1000 - 200;
+        int32_t jitter = n % 3 ? 40 : 0;
+        s[0] = { x, y };
+        s[1] = { x + w, y };
+        s[2] = { x + w, y + h };
+        s[3] = { x, y + h };
+        for (int k = 0; k < 4; k++) {
+            d[k].x = s[k].x + rand() % (2 * jitter + 1) - jitter + 100;
+            d[k].y = s[k].y + rand() % (2 * jitter + 1) - jitter - 50;
+        }
+
+        vg_lite_matrix_t exact;
+        if (vg_lite_get_transform_matrix(s, d, &matrix) != VG_LITE_SUCCESS || !bench_exact_matrix(s, d, &exact)) {
+            continue;
+        }
+
+        double quad_error = bench_corner_error(&matrix, s, d);
+        double quad_exact_error = bench_corner_error(&exact, s, d);
+        error = MAX(error, quad_error);
+        exact_error = MAX(exact_error, quad_exact_error);
+        excess = MAX(excess, quad_error - quad_exact_error);
+        solved++;
+    }
+    printf("  %u random quads, max corner error %.2e px, exact matrix in float %.2e px\n", solved, error, exact_error);
+    printf("  max corner error beyond the exact matrix in float %.2e px\n", excess);
+}
+
+/* picture_warp(): a 256x192 BGRA8888 image turned like a card in a 3D flip,
+ * warped into its device box of 362x262 pixels.
+ */
+static void bench_warp(void)
+{
+    auto ctx = vg_lite_ctx::get_instance();
+    vg_lite_buffer_t source, target;
+    bench_buffer(&source, 256, 192, VG_LITE_BGRA8888);
+    bench_buffer(&target, 480, 320, VG_LITE_BGRA8888);
+    canvas_set_target(ctx, &target);
+
+    vg_lite_point4_t src = { { 0, 0 }, { 256, 0 }, { 256, 192 }, { 0, 192 } };
+    vg_lite_point4_t dst = { { 60, 30 }, { 420, 80 }, { 420, 240 }, { 60, 290 } };
+    vg_lite_matrix_t matrix;
+    vg_lite_get_transform_matrix(src, dst, &matrix);
+
+    /* the device box with the one pixel margin picture_warp() adds */
+    uint32_t pixels = (420 - 60 + 2) * (290 - 30 + 2);
+
+    const struct {
+        const char* label;
+        vg_lite_filter_t filter;
+    } filters[] = {
+        { "point", VG_LITE_FILTER_POINT },
+        { "bilinear", VG_LITE_FILTER_BI_LINEAR },
+    };
+
+    for (const auto& f : filters) {
+        double ns = bench_time(200, [&](uint32_t) {
+            auto picture = Picture::gen();
+            picture_warp(ctx, picture, &target, &source, NULL, &matrix, f.filter, 0);
+            ctx->release_canvas_images();
+        });
+        bench_report(f.label, ns, pixels);
+    }
+
+    vg_lite_finish();
+    vg_lite_free(&source);
+    vg_lite_free(&target);
+}
+
+/* The scalar loop of the vg_lite_tvg_transform_points() kernels. */
+static void bench_transform_points_scalar(const vg_lite_matrix_t* matrix, const vg_lite_float_t* src, vg_lite_float_t* dst,
+    uint32_t count, bool perspective)
+{
+    const vg_lite_float_t(*m)[3] = matrix->m;
+    for (uint32_t i = 0; i < count; i++) {
+        vg_lite_float_t x = src[i * 2];
+        vg_lite_float_t y = src[i * 2 + 1];
+        vg_lite_float_t w = perspective ? x * m[2][0] + y * m[2][1] + m[2][2] : 1.0f;
+        dst[i * 2] = x * m[0][0] + y * m[0][1] + m[0][2];
+        dst[i * 2 + 1] = x * m[1][0] + y * m[1][1] + m[1][2];
+        if (perspective) {
+            dst[i * 2] /= w;
+            dst[i * 2 + 1] /= w;
+        }
+    }
+}
+
+/* vg_lite_tvg_transform_points() against the plain scalar loop, 4096 points
+ * per call, and whether both give the same bits, also for an odd count from
+ * an unaligned start that ends in the scalar tail.
+ */
+static void bench_transform_points(void)
+{
+#if defined(__SSE2__)
+    const char* kernel = "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const char* kernel = "NEON";
+#elif defined(__ARM_NEON)
+    const char* kernel = "NEON affine, scalar perspective";
+#else
+    const char* kernel = "scalar";
+#endif
+
+    const uint32_t count = 4096;
+    std::vector<vg_lite_float_t> src(count * 2);
+    std::vector<vg_lite_float_t> dst(count * 2);
+    std::vector<vg_lite_float_t> ref(count * 2);
+
+    srand(1);
+    for (auto& v : src) {
+        v = (rand() % 100000) / 100.0f - 500.0f;
+    }
+
+    vg_lite_matrix_t affine;
+    vg_lite_identity(&affine);
+    vg_lite_translate(100.5f, 20.25f, &affine);
+    vg_lite_rotate(33.0f, &affine);
+    vg_lite_scale(1.5f, 0.75f, &affine);
+
+    vg_lite_matrix_t perspective = affine;
+    vg_lite_perspective(0.0005f, 0.0002f, &perspective);
+
+    const struct {
+        const char* label;
+        const vg_lite_matrix_t* matrix;
+        bool perspective;
+    } cases[] = {
+        { "affine", &affine, false },
+        { "perspective", &perspective, true },
+    };
+
+    printf("  kernel: %s\n", kernel);
+
+    for (const auto& c : cases) {
+        char label[64];
+        double ns = bench_time(2000, [&](uint32_t) {
+            vg_lite_tvg_transform_points(c.matrix, src.data(), dst.data(), count);
+        });
+        snprintf(label, sizeof(label), "%s, per point", c.label);
+        bench_report(label, ns / count, 0);
+
+        ns = bench_time(2000, [&](uint32_t) {
+            bench_transform_points_scalar(c.matrix, src.data(), ref.data(), count, c.perspective);
+        });
+        snprintf(label, sizeof(label), "%s scalar loop, per point", c.label);
+        bench_report(label, ns / count, 0);
+
+        bool same = !memcmp(dst.data(), ref.data(), count * 2 * sizeof(vg_lite_float_t));
+
+        vg_lite_tvg_transform_points(c.matrix, src.data() + 2, dst.data() + 2, count - 1);
+        bench_transform_points_scalar(c.matrix, src.data() + 2, ref.data() + 2, count - 1, c.perspective);
+        same = same && !memcmp(dst.data() + 2, ref.data() + 2, (count - 1) * 2 * sizeof(vg_lite_float_t));
+
+        printf("  %s results %s\n", c.label, same ? "match" : "differ");
+    }
+}
+
+/* The color key on a 480x320 BGR565 image with four keys enabled: decoded
+ * without the key, with the key fused into the decode, with the key as a
+ * pass of its own, and color_key_span() alone against one pixel per call.
+ */
+static void bench_color_key(void)
+{
+    const uint32_t width = 480;
+    const uint32_t height = 320;
+    const uint32_t pixels = width * height;
+    vg_lite_buffer_t source, target;
+    bench_buffer(&source, width, height, VG_LITE_BGR565);
+    bench_buffer(&target, width, height, VG_LITE_BGRA8888);
+    uint32_t* bits = (uint32_t*)target.memory;
+
+    vg_lite_color_key4_t keys = {
+        /* enable, low RGB, alpha, high RGB */
+        { 1, 0x00, 0x00, 0x00, 0x00, 0x40, 0x80, 0x40 },
+        { 1, 0xc0, 0x00, 0x00, 0x40, 0xff, 0x80, 0x80 },
+        { 1, 0x00, 0x80, 0xc0, 0x80, 0x80, 0xff, 0xff },
+        { 1, 0x60, 0x60, 0x60, 0xc0, 0xa0, 0xa0, 0xa0 },
+    };
+
+    picture_line_ops_t ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.color_key = keys;
+
+    double ns = bench_time(200, [&](uint32_t) {
+        conv_bgr565_to_bgra8888.convert(&target, &source);
+    });
+    bench_report("plain decode", ns, pixels);
+
+    ns = bench_time(200, [&](uint32_t) {
+        conv_bgr565_to_bgra8888.convert(&target, &source, 0, &ops);
+    });
+    bench_report("decode with fused key", ns, pixels);
+
+    ns = bench_time(200, [&](uint32_t) {
+        conv_bgr565_to_bgra8888.convert(&target, &source);
+        color_key_span(bits, bits, pixels, keys, false);
+    });
+    bench_report("decode then separate pass", ns, pixels);
+
+    std::vector<uint32_t> decoded(bits, bits + pixels);
+    std::vector<uint32_t> keyed(pixels);
+    std::vector<uint32_t> ref(pixels);
+
+    ns = bench_time(200, [&](uint32_t) {
+        color_key_span(keyed.data(), decoded.data(), pixels, keys, false);
+    });
+    bench_report("key kernel alone", ns, pixels);
+
+    ns = bench_time(200, [&](uint32_t) {
+        for (uint32_t i = 0; i < pixels; i++) {
+            color_key_span(&ref[i], &decoded[i], 1, keys, false);
+        }
+    });
+    bench_report("key kernel, 1 px per call", ns, pixels);
+
+    uint32_t matched = 0;
+    for (uint32_t i = 0; i < pixels; i++) {
+        matched += keyed[i] != decoded[i];
+    }
+    printf("  %u of %u pixels keyed, results %s\n", matched, pixels,
+        memcmp(keyed.data(), ref.data(), pixels * sizeof(uint32_t)) ? "differ" : "match");
+
+    vg_lite_free(&source);
+    vg_lite_free(&target);
+}
+
+/* The 480x320 resolve into BGR565 and BGRA5658 targets, with and without
+ * the ordered dither.
+ */
+static void bench_dither(void)
+{
+    const uint32_t width = 480;
+    const uint32_t height = 320;
+    vg_lite_buffer_t canvas;
+    bench_buffer(&canvas, width, height, VG_LITE_BGRA8888);
+
+    const struct {
+        const char* label;
+        vg_lite_buffer_format_t format;
+    } formats[] = {
+        { "BGR565", VG_LITE_BGR565 },
+        { "BGRA5658", VG_LITE_BGRA5658 },
+    };
+
+    for (const auto& f : formats) {
+        vg_lite_buffer_t target;
+        bench_buffer(&target, width, height, f.format);
+
+        for (int dither = 0; dither < 2; dither++) {
+            char label[64];
+            double ns = bench_time(500, [&](uint32_t) {
+                picture_resolve_t resolve;
+                bench_resolve(&resolve, (const uint32_t*)canvas.memory, &target, 0);
+                if (f.format == VG_LITE_BGR565) {
+                    picture_bgra8888_to_bgr565((vg_color16_t*)target.memory, &resolve, dither);
+                } else {
+                    picture_bgra8888_to_bgra5658((vg_color16_alpha_t*)target.memory, &resolve, dither, VG_LITE_NORMAL, 0xff);
+                }
+            });
+            snprintf(label, sizeof(label), "%s, %s", f.label, dither ? "dither" : "no dither");
+            bench_report(label, ns, width * height);
+        }
+
+        vg_lite_free(&target);
+    }
+
+    vg_lite_free(&canvas);
+}
+
+/* The plain loop picture_rotate() replaces: one result row at a time, reading
+ * the source down a column for odd turns.
+ */
+static void bench_rotate_loop(uint32_t* dst, const uint32_t* src, uint32_t width, uint32_t height, uint32_t quarter)
+{
+    if (quarter == 2) {
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                dst[y * width + x] = src[(height - 1 - y) * width + width - 1 - x];
+            }
+        }
+        return;
+    }
+
+    for (uint32_t j = 0; j < width; j++) {
+        for (uint32_t i = 0; i < height; i++) {
+            dst[j * height + i] = picture_rotate_pixel(src, width, width, height, quarter, i, j);
+        }
+    }
+}
+
+/* picture_rotate() on a 1920x1080 BGRA8888 image turned by 90 and 180
+ * degrees, against the plain loop and a memcpy of the same size.
+ */
+static void bench_rotate(void)
+{
+    const uint32_t width = 1920;
+    const uint32_t height = 1080;
+    const uint32_t pixels = width * height;
+    vg_lite_buffer_t source;
+    bench_buffer(&source, width, height, VG_LITE_BGRA8888);
+    const uint32_t* src = (const uint32_t*)source.memory;
+    std::vector<uint32_t> dst(pixels);
+    std::vector<uint32_t> ref(pixels);
+
+    for (uint32_t quarter = 1; quarter <= 2; quarter++) {
+        char label[64];
+        double ns = bench_time(20, [&](uint32_t) {
+            bench_rotate_loop(ref.data(), src, width, height, quarter);
+        });
+        snprintf(label, sizeof(label), "plain loop, %u degrees", quarter * 90);
+        bench_report(label, ns, pixels);
+
+        ns = bench_time(20, [&](uint32_t) {
+            picture_rotate(dst.data(), src, width, width, height, quarter);
+        });
+        snprintf(label, sizeof(label), "picture_rotate, %u degrees", quarter * 90);
+        bench_report(label, ns, pixels);
+
+        printf("  %u degrees results %s\n", quarter * 90, memcmp(dst.data(), ref.data(), pixels * sizeof(uint32_t)) ? "differ" : "match");
+    }
+
+    double ns = bench_time(20, [&](uint32_t) {
+        memcpy(dst.data(), src, pixels * sizeof(uint32_t));
+    });
+    bench_report("memcpy", ns, pixels);
+
+    vg_lite_free(&source);
+}
+
+/* Append a circle of four cubic arcs around (cx, cy) to the FP32 (data). */
+static void bench_circle(std::vector<float>& data, float cx, float cy, float r)
+{
+    /* control point distance of a quarter circle */
+    const float k = 0.5523f * r;
+    const float arcs[4][6] = {
+        { cx + r, cy + k, cx + k, cy + r, cx, cy + r },
+        { cx - k, cy + r, cx - r, cy + k, cx - r, cy },
+        { cx - r, cy - k, cx - k, cy - r, cx, cy - r },
+        { cx + k, cy - r, cx + r, cy - k, cx + r, cy },
+    };
+    float op;
+
+    uint32_t move = VLC_OP_MOVE;
+    memcpy(&op, &move, sizeof(op));
+    data.insert(data.end(), { op, cx + r, cy });
+
+    uint32_t cubic = VLC_OP_CUBIC;
+    memcpy(&op, &cubic, sizeof(op));
+    for (const auto& arc : arcs) {
+        data.push_back(op);
+        data.insert(data.end(), arc, arc + 6);
+    }
+
+    uint32_t close = VLC_OP_CLOSE;
+    memcpy(&op, &close, sizeof(op));
+    data.push_back(op);
+}
+
+/* 48 circles of 3 to 144 pixels radius drawn into a 480x320 BGRA8888 target
+ * at each vg_lite_quality_t, the whole frame from vg_lite_draw() to
+ * vg_lite_finish(). The points handed to ThorVG and the largest distance of a
+ * flattened segment from the circle show what the time buys.
+ */
+static void bench_quality(void)
+{
+    const uint32_t width = 480;
+    const uint32_t height = 320;
+    const uint32_t count = 48;
+    vg_lite_buffer_t target;
+    bench_buffer(&target, width, height, VG_LITE_BGRA8888);
+
+    std::vector<float> data;
+    std::vector<float> radii;
+    for (uint32_t i = 0; i < count; i++) {
+        float r = 3.0f * (i + 1);
+        bench_circle(data, (float)(40 + i * 83 % 400), (float)(40 + i * 59 % 240), r);
+        radii.push_back(r);
+    }
+    float end;
+    uint32_t op = VLC_OP_END;
+    memcpy(&end, &op, sizeof(end));
+    data.push_back(end);
+
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+
+    const struct {
+        const char* label;
+        vg_lite_quality_t quality;
+    } qualities[] = {
+        { "LOW", VG_LITE_LOW },
+        { "MEDIUM", VG_LITE_MEDIUM },
+        { "UPPER", VG_LITE_UPPER },
+        { "HIGH", VG_LITE_HIGH },
+    };
+
+    for (const auto& q : qualities) {
+        vg_lite_path_t path;
+        vg_lite_init_path(&path, VG_LITE_FP32, q.quality, data.size() * sizeof(float), data.data(), 0, 0, width, height);
+
+        char label[64];
+        double ns = bench_time(50, [&](uint32_t) {
+            vg_lite_draw(&target, &path, VG_LITE_FILL_NON_ZERO, &matrix, VG_LITE_BLEND_SRC_OVER, 0xff2080c0);
+            vg_lite_finish();
+        });
+        snprintf(label, sizeof(label), "%s, frame", q.label);
+        bench_report(label, ns, width * height);
+
+        /* the flattened segments against the circles they stand for */
+        path_raster_t* raster = vg_lite_ctx::get_instance()->get_path_raster();
+        path_raster_parse(raster, &path, &matrix);
+        const PathCommand* cmds = raster->cmd_data;
+        const Point* pts = raster->pt_data;
+        double error = 0;
+        bool curves = false;
+        int32_t circle = -1;
+        Point center = { 0, 0 };
+        Point last = { 0, 0 };
+        for (uint32_t i = 0; i < raster->cmd_count; i++) {
+            switch (cmds[i]) {
+            case PathCommand::MoveTo:
+                circle++;
+                last = *pts++;
+                center = { last.x - radii[circle], last.y };
+                break;
+            case PathCommand::LineTo: {
+                Point mid = { (last.x + pts->x) / 2, (last.y + pts->y) / 2 };
+                double d = radii[circle] - hypot(mid.x - center.x, mid.y - center.y);
+                error = MAX(error, fabs(d));
+                last = *pts++;
+                break;
+            }
+            case PathCommand::CubicTo:
+                curves = true;
+                last = pts[2];
+                pts += 3;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (curves) {
+            printf("  %s: %u points, curves kept for ThorVG\n", q.label, raster->pt_count);
+        } else {
+            printf("  %s: %u points, %.3f px from the circles\n", q.label, raster->pt_count, error);
+        }
+    }
+
+    vg_lite_free(&target);
+}
+
+/* A vertical and a horizontal gradient over a 400x280 rectangle of a 480x320
+ * BGRA8888 target, the whole frame from vg_lite_draw_linear_grad() to
+ * vg_lite_finish(). Two stops take the per row or column evaluation, the
+ * same ramp with a third stop halfway takes the cached ThorVG fill.
+ */
+static void bench_linear_grad(void)
+{
+    const uint32_t width = 480;
+    const uint32_t height = 320;
+    vg_lite_buffer_t target;
+    bench_buffer(&target, width, height, VG_LITE_BGRA8888);
+
+    int16_t data[] = { VLC_OP_MOVE, 40, 20, VLC_OP_LINE, 440, 20, VLC_OP_LINE, 440, 300, VLC_OP_LINE, 40, 300, VLC_OP_END };
+    vg_lite_path_t path;
+    vg_lite_init_path(&path, VG_LITE_S16, VG_LITE_HIGH, sizeof(data), data, 40, 20, 440, 300);
+
+    vg_lite_matrix_t matrix;
+    vg_lite_identity(&matrix);
+
+    /* the middle stop lies on the line between the others, both ramps look the same */
+    vg_lite_color_ramp_t ramp[] = {
+        { 0.0f, 1.0f, 0.2f, 0.0f, 1.0f },
+        { 0.5f, 0.5f, 0.4f, 0.5f, 1.0f },
+        { 1.0f, 0.0f, 0.6f, 1.0f, 1.0f },
+    };
+    vg_lite_color_ramp_t ends[] = { ramp[0], ramp[2] };
+
+    const struct {
+        const char* label;
+        vg_lite_linear_gradient_parameter_t params;
+    } directions[] = {
+        { "vertical", { 0, 20, 0, 300 } },
+        { "horizontal", { 40, 0, 440, 0 } },
+    };
+
+    for (const auto& d : directions) {
+        for (uint32_t count = 2; count <= 3; count++) {
+            vg_lite_ext_linear_gradient_t grad;
+            memset(&grad, 0, sizeof(grad));
+            vg_lite_set_linear_grad(&grad, count, count == 2 ? ends : ramp, d.params, VG_LITE_GRADIENT_SPREAD_PAD, 0);
+            vg_lite_update_linear_grad(&grad);
+            vg_lite_identity(&grad.matrix);
+
+            char label[64];
+            double ns = bench_time(200, [&](uint32_t) {
+                vg_lite_draw_linear_grad(&target, &path, VG_LITE_FILL_NON_ZERO, &matrix, &grad, 0, VG_LITE_BLEND_SRC_OVER,
+                    VG_LITE_FILTER_LINEAR);
+                vg_lite_finish();
+            });
+            snprintf(label, sizeof(label), "%s, %u stops", d.label, count);
+            bench_report(label, ns, 400 * 280);
+
+            vg_lite_clear_linear_grad(&grad);
+        }
+    }
+
+    vg_lite_free(&target);
+}
+
+/* The default 64/32/16 Gaussian kernel on a 480x320 BGRA8888 image, read
+ * directly and as a row pass and a column pass, and whether both give the
+ * same bits. A cached result is found again from a BGR565 source without
+ * decoding it.
+ */
+static void bench_gaussian(void)
+{
+    const uint32_t width = 480;
+    const uint32_t height = 320;
+    auto ctx = vg_lite_ctx::get_instance();
+    vg_lite_buffer_t source;
+    bench_buffer(&source, width, height, VG_LITE_BGRA8888);
+    const uint32_t* src = (const uint32_t*)source.memory;
+    std::vector<uint32_t> direct(width * height);
+    std::vector<uint32_t> separable(width * height);
+
+    const int32_t weights[3] = { 64, 32, 16 };
+    int32_t taps[2];
+    picture_gauss_split(weights, taps);
+
+    double ns = bench_time(100, [&](uint32_t) {
+        picture_gauss_blur(direct.data(), src, width, height, weights);
+    });
+    bench_report("direct 3x3", ns, width * height);
+
+    ns = bench_time(100, [&](uint32_t) {
+        picture_gauss_separable(separable.data(), src, width, height, taps, ctx->get_gauss_rows(width));
+    });
+    bench_report("row and column pass", ns, width * height);
+
+    printf("  results %s\n", direct == separable ? "match" : "differ");
+
+    vg_lite_buffer_t rgb565;
+    bench_buffer(&rgb565, width, height, VG_LITE_BGR565);
+    picture_gaussian(ctx, &rgb565, 0);
+    ns = bench_time(100, [&](uint32_t) {
+        picture_gaussian(ctx, &rgb565, 0);
+    });
+    bench_report("BGR565 cache hit", ns, width * height);
+
+    ctx->release_canvas_images();
+    vg_lite_free(&rgb565);
+    vg_lite_free(&source);
+}
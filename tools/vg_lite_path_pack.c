@@ -0,0 +1,380 @@
+/**
+ * @file vg_lite_path_pack.c
+ *
+ * Offline converter from VLC path streams to a vg_lite_tvg path pack.
+ *
+ * Build on the host:
+ *   cc -O2 -I.. -o vg_lite_path_pack vg_lite_path_pack.c
+ *
+ * Usage:
+ *   vg_lite_path_pack [-f s8|s16|s32|fp32] [-e] -o output.bin input.vlc...
+ *
+ * Each input file holds the raw VLC data of one path, as passed to
+ * vg_lite_init_path(). The bounding box of each path is the bounds of its
+ * points.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "vg_lite_tvg.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define PACK_ALIGN(number) (((number) + 3) & ~3U)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    vg_lite_tvg_path_pack_entry_t entry;
+    uint8_t* cmds;
+    float* pts;
+    uint32_t cmd_cap;
+    uint32_t pt_cap;
+} pack_path_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int read_file(const char* filename, uint8_t** data, uint32_t* size);
+static int convert_path(pack_path_t* path, const uint8_t* data, uint32_t size, vg_lite_format_t format);
+static int write_pack(const char* filename, pack_path_t* paths, uint32_t count);
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(int argc, char* argv[])
+{
+    vg_lite_format_t format = VG_LITE_FP32;
+    vg_lite_fill_t fill_rule = VG_LITE_FILL_NON_ZERO;
+    const char* output = NULL;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!strcmp(argv[i], "-e")) {
+            fill_rule = VG_LITE_FILL_EVEN_ODD;
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "s8")) {
+                format = VG_LITE_S8;
+            } else if (!strcmp(argv[i], "s16")) {
+                format = VG_LITE_S16;
+            } else if (!strcmp(argv[i], "s32")) {
+                format = VG_LITE_S32;
+            } else if (!strcmp(argv[i], "fp32")) {
+                format = VG_LITE_FP32;
+            } else {
+                fprintf(stderr, "unknown format: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (!output || i >= argc) {
+        fprintf(stderr, "usage: %s [-f s8|s16|s32|fp32] [-e] -o output.bin input.vlc...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t count = argc - i;
+    pack_path_t* paths = calloc(count, sizeof(pack_path_t));
+    if (!paths) {
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        uint8_t* data;
+        uint32_t size;
+
+        if (read_file(argv[i + n], &data, &size) < 0) {
+            return EXIT_FAILURE;
+        }
+
+        if (convert_path(&paths[n], data, size, format) < 0) {
+            fprintf(stderr, "%s: invalid VLC path data\n", argv[i + n]);
+            return EXIT_FAILURE;
+        }
+
+        paths[n].entry.fill_rule = fill_rule;
+        free(data);
+    }
+
+    if (write_pack(output, paths, count) < 0) {
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        free(paths[n].cmds);
+        free(paths[n].pts);
+    }
+    free(paths);
+
+    return EXIT_SUCCESS;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static int read_file(const char* filename, uint8_t** data, uint32_t* size)
+{
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        perror(filename);
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    *data = malloc(len > 0 ? len : 1);
+    if (!*data || fread(*data, 1, len, fp) != (size_t)len) {
+        perror(filename);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+    *size = (uint32_t)len;
+    return 0;
+}
+
+static uint8_t vlc_format_len(vg_lite_format_t format)
+{
+    switch (format) {
+    case VG_LITE_S8:
+        return 1;
+    case VG_LITE_S16:
+        return 2;
+    case VG_LITE_S32:
+    case VG_LITE_FP32:
+        return 4;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int vlc_op_arg_len(uint8_t vlc_op)
+{
+    switch (vlc_op) {
+    case VLC_OP_END:
+    case VLC_OP_CLOSE:
+        return 0;
+    case VLC_OP_MOVE:
+    case VLC_OP_LINE:
+        return 2;
+    case VLC_OP_QUAD:
+        return 4;
+    case VLC_OP_CUBIC:
+        return 6;
+    default:
+        break;
+    }
+
+    /* relative and arc commands are not drawn by vg_lite_tvg either */
+    return -1;
+}
+
+static float vlc_get_arg(const uint8_t* data, vg_lite_format_t format)
+{
+    int16_t s16;
+    int32_t s32;
+    float fp32;
+
+    switch (format) {
+    case VG_LITE_S8:
+        return (int8_t)*data;
+    case VG_LITE_S16:
+        memcpy(&s16, data, sizeof(s16));
+        return s16;
+    case VG_LITE_S32:
+        memcpy(&s32, data, sizeof(s32));
+        return (float)s32;
+    default:
+        memcpy(&fp32, data, sizeof(fp32));
+        return fp32;
+    }
+}
+
+static int add_cmd(pack_path_t* path, uint8_t cmd)
+{
+    if (path->entry.cmd_count == path->cmd_cap) {
+        path->cmd_cap = path->cmd_cap ? path->cmd_cap * 2 : 64;
+        path->cmds = realloc(path->cmds, path->cmd_cap);
+        if (!path->cmds) {
+            return -1;
+        }
+    }
+
+    path->cmds[path->entry.cmd_count++] = cmd;
+    return 0;
+}
+
+static int add_point(pack_path_t* path, float x, float y)
+{
+    vg_lite_tvg_path_pack_entry_t* entry = &path->entry;
+
+    if (entry->pt_count == path->pt_cap) {
+        path->pt_cap = path->pt_cap ? path->pt_cap * 2 : 64;
+        path->pts = realloc(path->pts, path->pt_cap * 2 * sizeof(float));
+        if (!path->pts) {
+            return -1;
+        }
+    }
+
+    path->pts[entry->pt_count * 2] = x;
+    path->pts[entry->pt_count * 2 + 1] = y;
+    entry->pt_count++;
+
+    if (x < entry->bounds[0]) entry->bounds[0] = x;
+    if (y < entry->bounds[1]) entry->bounds[1] = y;
+    if (x > entry->bounds[2]) entry->bounds[2] = x;
+    if (y > entry->bounds[3]) entry->bounds[3] = y;
+    return 0;
+}
+
+/* Same interpretation of the VLC data as shape_append_path() at HIGH quality. */
+static int convert_path(pack_path_t* path, const uint8_t* data, uint32_t size, vg_lite_format_t format)
+{
+    const uint8_t* cur = data;
+    const uint8_t* end = data + size;
+    uint8_t fmt_len = vlc_format_len(format);
+    float cur_x = 0, cur_y = 0;
+    float start_x = 0, start_y = 0;
+    float a[6];
+
+    path->entry.bounds[0] = path->entry.bounds[1] = FLT_MAX;
+    path->entry.bounds[2] = path->entry.bounds[3] = -FLT_MAX;
+
+    while (cur < end) {
+        uint8_t op_code = *cur;
+        int arg_len = vlc_op_arg_len(op_code);
+
+        if (arg_len < 0 || cur + fmt_len * (1 + arg_len) > end) {
+            return -1;
+        }
+
+        cur += fmt_len;
+        for (int i = 0; i < arg_len; i++) {
+            a[i] = vlc_get_arg(cur + i * fmt_len, format);
+        }
+        cur += arg_len * fmt_len;
+
+        int ret = 0;
+        switch (op_code) {
+        case VLC_OP_MOVE:
+            start_x = cur_x = a[0];
+            start_y = cur_y = a[1];
+            ret |= add_cmd(path, VG_LITE_TVG_PATH_CMD_MOVE);
+            ret |= add_point(path, a[0], a[1]);
+            break;
+
+        case VLC_OP_LINE:
+            cur_x = a[0];
+            cur_y = a[1];
+            ret |= add_cmd(path, VG_LITE_TVG_PATH_CMD_LINE);
+            ret |= add_point(path, a[0], a[1]);
+            break;
+
+        case VLC_OP_QUAD:
+            /* elevate to a cubic */
+            ret |= add_cmd(path, VG_LITE_TVG_PATH_CMD_CUBIC);
+            ret |= add_point(path, cur_x + (a[0] - cur_x) * 2 / 3, cur_y + (a[1] - cur_y) * 2 / 3);
+            ret |= add_point(path, a[2] + (a[0] - a[2]) * 2 / 3, a[3] + (a[1] - a[3]) * 2 / 3);
+            ret |= add_point(path, a[2], a[3]);
+            cur_x = a[2];
+            cur_y = a[3];
+            break;
+
+        case VLC_OP_CUBIC:
+            ret |= add_cmd(path, VG_LITE_TVG_PATH_CMD_CUBIC);
+            ret |= add_point(path, a[0], a[1]);
+            ret |= add_point(path, a[2], a[3]);
+            ret |= add_point(path, a[4], a[5]);
+            cur_x = a[4];
+            cur_y = a[5];
+            break;
+
+        default:
+            /* VLC_OP_CLOSE and VLC_OP_END */
+            ret |= add_cmd(path, VG_LITE_TVG_PATH_CMD_CLOSE);
+            cur_x = start_x;
+            cur_y = start_y;
+            break;
+        }
+
+        if (ret < 0) {
+            return -1;
+        }
+    }
+
+    if (!path->entry.pt_count) {
+        memset(path->entry.bounds, 0, sizeof(path->entry.bounds));
+    }
+
+    memcpy(path->entry.bounding_box, path->entry.bounds, sizeof(path->entry.bounding_box));
+    return 0;
+}
+
+static int write_pack(const char* filename, pack_path_t* paths, uint32_t count)
+{
+    static const uint8_t padding[4] = { 0 };
+    vg_lite_tvg_path_pack_header_t header;
+    uint32_t offset = sizeof(header) + count * sizeof(vg_lite_tvg_path_pack_entry_t);
+
+    /* point array first, 4-byte aligned, then the commands */
+    for (uint32_t n = 0; n < count; n++) {
+        vg_lite_tvg_path_pack_entry_t* entry = &paths[n].entry;
+        entry->pt_offset = offset;
+        offset += entry->pt_count * 2 * sizeof(float);
+        entry->cmd_offset = offset;
+        offset = PACK_ALIGN(offset + entry->cmd_count);
+    }
+
+    header.magic = VG_LITE_TVG_PATH_PACK_MAGIC;
+    header.version = VG_LITE_TVG_PATH_PACK_VERSION;
+    header.path_count = count;
+    header.size = offset;
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        perror(filename);
+        return -1;
+    }
+
+    fwrite(&header, sizeof(header), 1, fp);
+    for (uint32_t n = 0; n < count; n++) {
+        fwrite(&paths[n].entry, sizeof(vg_lite_tvg_path_pack_entry_t), 1, fp);
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        vg_lite_tvg_path_pack_entry_t* entry = &paths[n].entry;
+        fwrite(paths[n].pts, sizeof(float), entry->pt_count * 2, fp);
+        fwrite(paths[n].cmds, 1, entry->cmd_count, fp);
+        fwrite(padding, 1, PACK_ALIGN(entry->cmd_count) - entry->cmd_count, fp);
+    }
+
+    if (fclose(fp) != 0) {
+        perror(filename);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,377 @@
+/**
+ * @file vg_lite_ramp_check.c
+ *
+ * Bit-exactness check of the gradient ramp builders against the per-texel
+ * loops they replaced.
+ *
+ * Build on the host:
+ *   cc -O2 -I.. -c vg_lite_ramp_check.c ../vg_lite_matrix.c
+ *   c++ -O2 -std=c++14 -I.. -I<thorvg>/inc -c ../vg_lite_tvg.cpp
+ *   c++ -o vg_lite_ramp_check vg_lite_ramp_check.o vg_lite_matrix.o vg_lite_tvg.o -lthorvg
+ *
+ * Compile vg_lite_tvg.cpp once more with -U__SSE2__ to check the scalar
+ * kernels as well.
+ *
+ * Usage:
+ *   vg_lite_ramp_check [iterations] [seed]
+ *
+ * Random ramps go through vg_lite_update_linear_grad(),
+ * vg_lite_update_radial_grad() and vg_lite_update_grad(), and every ramp
+ * image is compared byte for byte with the reference loop. The exit status
+ * is non-zero on any mismatch.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "vg_lite.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LERP(v1, v2, w) ((v1) * (w) + (v2) * (1.0f - (w)))
+#define CLAMP(x, min, max) (((x) < (min)) ? (min) : ((x) > (max)) ? (max) : (x))
+
+#define A(color) ((color) >> 24)
+#define R(color) (((color) & 0x00ff0000) >> 16)
+#define G(color) (((color) & 0x0000ff00) >> 8)
+#define B(color) ((color) & 0xff)
+#define ARGB(a, r, g, b) ((a) << 24) | ((r) << 16) | ((g) << 8) | (b)
+
+#define CHECK_MAX_STOPS 8
+#define CHECK_MAX_GRAD_STOPS 16
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+static int check_ramp(uint32_t iteration);
+static int check_grad(uint32_t iteration);
+static void ref_ramp_fill(uint8_t* bits, uint32_t width, const vg_lite_color_ramp_t* color_ramp, uint8_t pre_multiplied);
+static void ref_grad_fill(const vg_lite_linear_gradient_t* grad, uint32_t* buffer);
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000;
+    uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    uint32_t ramp_bad = 0;
+    uint32_t grad_bad = 0;
+
+    srand(seed);
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        ramp_bad += check_ramp(i);
+    }
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        grad_bad += check_grad(i);
+    }
+
+    printf("linear/radial ramps: %u runs, %u mismatches\n", iterations, ramp_bad);
+    printf("vg_lite_update_grad: %u runs, %u mismatches\n", iterations, grad_bad);
+    return ramp_bad || grad_bad ? 1 : 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/* Channel values the converters produce, halves and exact 0/1 included. */
+static float random_channel(void)
+{
+    switch (rand() % 4) {
+    case 0:
+        return (rand() % 256) / 255.0f;
+    case 1:
+        return (rand() % 512 + 0.5f) / 510.0f;
+    case 2:
+        return (float)(rand() % 2);
+    default:
+        return rand() / (float)RAND_MAX;
+    }
+}
+
+/* Stops on texel centers as well as anywhere in between. */
+static float random_stop(void)
+{
+    switch (rand() % 3) {
+    case 0:
+        return (rand() % 9) / 8.0f;
+    case 1:
+        return (rand() % 101) / 100.0f;
+    default:
+        return rand() / (float)RAND_MAX;
+    }
+}
+
+static int check_ramp(uint32_t iteration)
+{
+    vg_lite_color_ramp_t ramp[CHECK_MAX_STOPS];
+    uint32_t count = 1 + rand() % CHECK_MAX_STOPS;
+    float stops[CHECK_MAX_STOPS];
+
+    for (uint32_t i = 0; i < count; i++) {
+        stops[i] = random_stop();
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = i + 1; j < count; j++) {
+            if (stops[j] < stops[i]) {
+                float t = stops[i];
+                stops[i] = stops[j];
+                stops[j] = t;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        ramp[i].stop = stops[i];
+        ramp[i].red = random_channel();
+        ramp[i].green = random_channel();
+        ramp[i].blue = random_channel();
+        ramp[i].alpha = random_channel();
+    }
+
+    uint8_t pre_multiplied = rand() % 2;
+    float length = (float)(1 + rand() % 600);
+    const vg_lite_color_ramp_t* converted;
+    const void* memory;
+    uint32_t width;
+    int bad = 0;
+
+    vg_lite_ext_linear_gradient_t linear;
+    vg_lite_radial_gradient_t radial;
+    memset(&linear, 0, sizeof(linear));
+    memset(&radial, 0, sizeof(radial));
+
+    if (iteration & 1) {
+        vg_lite_linear_gradient_parameter_t param = { 0, 0, length, (float)(rand() % 50) };
+        vg_lite_set_linear_grad(&linear, count, ramp, param, VG_LITE_GRADIENT_SPREAD_PAD, pre_multiplied);
+        if (vg_lite_update_linear_grad(&linear) != VG_LITE_SUCCESS) {
+            return 0;
+        }
+        converted = linear.converted_ramp;
+        memory = linear.image.memory;
+        width = linear.image.width;
+    } else {
+        vg_lite_radial_gradient_parameter_t param = { 10, 10, length, 10, 10 };
+        vg_lite_set_radial_grad(&radial, count, ramp, param, VG_LITE_GRADIENT_SPREAD_PAD, pre_multiplied);
+        if (vg_lite_update_radial_grad(&radial) != VG_LITE_SUCCESS) {
+            return 0;
+        }
+        converted = radial.converted_ramp;
+        memory = radial.image.memory;
+        width = radial.image.stride / 4;
+    }
+
+    uint8_t* ref = (uint8_t*)malloc(width * 4);
+    if (!ref) {
+        return 1;
+    }
+
+    ref_ramp_fill(ref, width, converted, pre_multiplied);
+    if (memcmp(ref, memory, width * 4)) {
+        printf("ramp %u: mismatch, %u stops, width %u\n", iteration, count, width);
+        bad = 1;
+    }
+    free(ref);
+
+    if (iteration & 1) {
+        vg_lite_clear_linear_grad(&linear);
+    } else {
+        vg_lite_clear_radial_grad(&radial);
+    }
+    return bad;
+}
+
+static int check_grad(uint32_t iteration)
+{
+    vg_lite_linear_gradient_t grad;
+    uint32_t colors[CHECK_MAX_GRAD_STOPS];
+    uint32_t stops[CHECK_MAX_GRAD_STOPS];
+    uint32_t count = rand() % (CHECK_MAX_GRAD_STOPS + 1);
+    static uint32_t ref[VLC_GRADIENT_BUFFER_WIDTH];
+    int bad = 0;
+
+    memset(&grad, 0, sizeof(grad));
+    if (vg_lite_init_grad(&grad) != VG_LITE_SUCCESS) {
+        return 1;
+    }
+
+    /* out of range stops are dropped by vg_lite_set_grad() */
+    for (uint32_t i = 0; i < count; i++) {
+        colors[i] = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+        stops[i] = rand() % (iteration & 1 ? 1024 : 256);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = i + 1; j < count; j++) {
+            if (stops[j] < stops[i]) {
+                uint32_t t = stops[i];
+                stops[i] = stops[j];
+                stops[j] = t;
+            }
+        }
+    }
+
+    vg_lite_set_grad(&grad, count, colors, stops);
+
+    /* the texels the update leaves alone keep their previous value */
+    vg_lite_linear_gradient_t ref_grad = grad;
+    memcpy(ref, grad.image.memory, sizeof(ref));
+
+    vg_lite_update_grad(&grad);
+    ref_grad_fill(&ref_grad, ref);
+
+    if (memcmp(ref, grad.image.memory, sizeof(ref))) {
+        printf("grad %u: mismatch, %u stops\n", iteration, grad.count);
+        bad = 1;
+    }
+
+    vg_lite_clear_grad(&grad);
+    return bad;
+}
+
+static uint8_t ref_pack(vg_lite_float_t value)
+{
+    vg_lite_float_t rounded = value * 255.0f + 0.5f;
+    int32_t rounded_int = (int32_t)rounded;
+    return (uint8_t)CLAMP(rounded_int, 0, 255);
+}
+
+/* The per-texel loop of vg_lite_update_linear_grad() and
+ * vg_lite_update_radial_grad() before the segment kernels.
+ */
+static void ref_ramp_fill(uint8_t* bits, uint32_t width, const vg_lite_color_ramp_t* color_ramp, uint8_t pre_multiplied)
+{
+    uint32_t stop = 0;
+
+    for (uint32_t i = 0; i < width; ++i) {
+        vg_lite_float_t gradient;
+        vg_lite_float_t color[4];
+        vg_lite_float_t color1[4];
+        vg_lite_float_t color2[4];
+        vg_lite_float_t weight;
+
+        gradient = (vg_lite_float_t)i / (vg_lite_float_t)(width - 1);
+
+        while (gradient > color_ramp[stop].stop) {
+            ++stop;
+        }
+
+        if (gradient == color_ramp[stop].stop) {
+            weight = 1.0f;
+
+            color1[3] = color_ramp[stop].alpha;
+            color1[2] = color_ramp[stop].blue;
+            color1[1] = color_ramp[stop].green;
+            color1[0] = color_ramp[stop].red;
+
+            color2[3] = color2[2] = color2[1] = color2[0] = 0.0f;
+        } else {
+            weight = (color_ramp[stop].stop - gradient)
+                / (color_ramp[stop].stop - color_ramp[stop - 1].stop);
+
+            color1[3] = color_ramp[stop - 1].alpha;
+            color1[2] = color_ramp[stop - 1].blue;
+            color1[1] = color_ramp[stop - 1].green;
+            color1[0] = color_ramp[stop - 1].red;
+
+            color2[3] = color_ramp[stop].alpha;
+            color2[2] = color_ramp[stop].blue;
+            color2[1] = color_ramp[stop].green;
+            color2[0] = color_ramp[stop].red;
+        }
+
+        if (pre_multiplied) {
+            color1[2] *= color1[3];
+            color1[1] *= color1[3];
+            color1[0] *= color1[3];
+
+            color2[2] *= color2[3];
+            color2[1] *= color2[3];
+            color2[0] *= color2[3];
+        }
+
+        color[3] = LERP(color1[3], color2[3], weight);
+        color[2] = LERP(color1[2], color2[2], weight);
+        color[1] = LERP(color1[1], color2[1], weight);
+        color[0] = LERP(color1[0], color2[0], weight);
+
+        *bits++ = ref_pack(color[3]);
+        *bits++ = ref_pack(color[2]);
+        *bits++ = ref_pack(color[1]);
+        *bits++ = ref_pack(color[0]);
+    }
+}
+
+/* vg_lite_update_grad() with its four divides per texel. */
+static void ref_grad_fill(const vg_lite_linear_gradient_t* grad, uint32_t* buffer)
+{
+    vg_lite_linear_gradient_t implicit;
+    int32_t r0, g0, b0, a0;
+    int32_t r1, g1, b1, a1;
+    int32_t lr, lg, lb, la;
+    int32_t j;
+    int32_t ds, dr, dg, db, da;
+    uint32_t i;
+
+    if (grad->count == 0) {
+        implicit = *grad;
+        implicit.stops[0] = 0;
+        implicit.colors[0] = 0xFF000000;
+        implicit.stops[1] = 255;
+        implicit.colors[1] = 0xFFFFFFFF;
+        implicit.count = 2;
+        grad = &implicit;
+    } else if (grad->stops[0] != 0) {
+        for (i = 0; i < grad->stops[0]; i++)
+            buffer[i] = grad->colors[0];
+    }
+
+    a0 = A(grad->colors[0]);
+    r0 = R(grad->colors[0]);
+    g0 = G(grad->colors[0]);
+    b0 = B(grad->colors[0]);
+
+    for (i = 0; i < grad->count - 1; i++) {
+        buffer[grad->stops[i]] = grad->colors[i];
+        ds = grad->stops[i + 1] - grad->stops[i];
+        a1 = A(grad->colors[i + 1]);
+        r1 = R(grad->colors[i + 1]);
+        g1 = G(grad->colors[i + 1]);
+        b1 = B(grad->colors[i + 1]);
+
+        da = a1 - a0;
+        dr = r1 - r0;
+        dg = g1 - g0;
+        db = b1 - b0;
+
+        for (j = 1; j < ds; j++) {
+            la = a0 + da * j / ds;
+            lr = r0 + dr * j / ds;
+            lg = g0 + dg * j / ds;
+            lb = b0 + db * j / ds;
+
+            buffer[grad->stops[i] + j] = ARGB(la, lr, lg, lb);
+        }
+
+        a0 = a1;
+        r0 = r1;
+        g0 = g1;
+        b0 = b1;
+    }
+
+    for (i = grad->stops[grad->count - 1]; i < VLC_GRADIENT_BUFFER_WIDTH; i++)
+        buffer[i] = grad->colors[grad->count - 1];
+}
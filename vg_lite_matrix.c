@@ -27,7 +27,13 @@
 
 #include <math.h>
 #include <string.h>
-#include "vg_lite.h"
+#include "vg_lite_tvg.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 
 vg_lite_error_t vg_lite_identity(vg_lite_matrix_t * matrix)
@@ -45,11 +51,55 @@ vg_lite_error_t vg_lite_identity(vg_lite_matrix_t * matrix)
     return VG_LITE_SUCCESS;
 }
 
-static void multiply(vg_lite_matrix_t * matrix, vg_lite_matrix_t * mult)
+vg_lite_tvg_matrix_type_t vg_lite_tvg_matrix_classify(const vg_lite_matrix_t * matrix)
+{
+    const vg_lite_float_t (*m)[3] = matrix->m;
+
+    if (m[2][0] != 0.0f || m[2][1] != 0.0f || m[2][2] != 1.0f)
+        return VG_LITE_TVG_MATRIX_PERSPECTIVE;
+
+    if (m[0][1] != 0.0f || m[1][0] != 0.0f)
+        return VG_LITE_TVG_MATRIX_AFFINE;
+
+    if (m[0][0] != 1.0f || m[1][1] != 1.0f)
+        return VG_LITE_TVG_MATRIX_SCALE;
+
+    if (m[0][2] != 0.0f || m[1][2] != 0.0f)
+        return VG_LITE_TVG_MATRIX_TRANSLATE;
+
+    return VG_LITE_TVG_MATRIX_IDENTITY;
+}
+
+/* A bottom row of (0, 0, 1) stays so through the compose routines below. */
+#define IS_AFFINE(matrix) \
+    ((matrix)->m[2][0] == 0.0f && (matrix)->m[2][1] == 0.0f && (matrix)->m[2][2] == 1.0f)
+
+static void multiply(vg_lite_matrix_t * matrix, const vg_lite_matrix_t * mult)
 {
     vg_lite_matrix_t temp;
     int row, column;
 
+    if (vg_lite_tvg_matrix_classify(mult) == VG_LITE_TVG_MATRIX_IDENTITY)
+        return;
+
+    if (vg_lite_tvg_matrix_classify(matrix) == VG_LITE_TVG_MATRIX_IDENTITY) {
+        memcpy(matrix, mult, sizeof(*matrix));
+        return;
+    }
+
+    if (IS_AFFINE(matrix) && IS_AFFINE(mult)) {
+        /* Same sums as below without the zero terms, the bottom row stays. */
+        for (row = 0; row < 2; row++) {
+            vg_lite_float_t m0 = matrix->m[row][0];
+            vg_lite_float_t m1 = matrix->m[row][1];
+
+            matrix->m[row][0] = (m0 * mult->m[0][0]) + (m1 * mult->m[1][0]);
+            matrix->m[row][1] = (m0 * mult->m[0][1]) + (m1 * mult->m[1][1]);
+            matrix->m[row][2] = (m0 * mult->m[0][2]) + (m1 * mult->m[1][2]) + matrix->m[row][2];
+        }
+        return;
+    }
+
     /* Process all rows. */
     for (row = 0; row < 3; row++) {
         /* Process all columns. */
@@ -65,29 +115,40 @@ static void multiply(vg_lite_matrix_t * matrix, vg_lite_matrix_t * mult)
     memcpy(matrix, &temp, sizeof(temp));
 }
 
+vg_lite_error_t vg_lite_tvg_matrix_multiply(vg_lite_matrix_t * matrix, const vg_lite_matrix_t * mult)
+{
+    if (!matrix || !mult)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    multiply(matrix, mult);
+    return VG_LITE_SUCCESS;
+}
+
+/* The compose routines below only update the columns the operation
+ * touches, with the same sums multiply() would compute for them.
+ */
+
 vg_lite_error_t vg_lite_translate(vg_lite_float_t x, vg_lite_float_t y, vg_lite_matrix_t * matrix)
 {
-    /* Set translation matrix. */
-    vg_lite_matrix_t t = { { {1.0f, 0.0f, x},
-        {0.0f, 1.0f, y},
-        {0.0f, 0.0f, 1.0f}
-    } };
-
-    /* Multiply with current matrix. */
-    multiply(matrix, &t);
+    int row, rows = IS_AFFINE(matrix) ? 2 : 3;
+
+    /* Column 2 picks up the translation. */
+    for (row = 0; row < rows; row++)
+        matrix->m[row][2] = (matrix->m[row][0] * x) + (matrix->m[row][1] * y) + matrix->m[row][2];
+
     return VG_LITE_SUCCESS;
 }
 
 vg_lite_error_t vg_lite_scale(vg_lite_float_t scale_x, vg_lite_float_t scale_y, vg_lite_matrix_t * matrix)
 {
-    /* Set scale matrix. */
-    vg_lite_matrix_t s = { { {scale_x, 0.0f, 0.0f},
-        {0.0f, scale_y, 0.0f},
-        {0.0f, 0.0f, 1.0f}
-    } };
-
-    /* Multiply with current matrix. */
-    multiply(matrix, &s);
+    int row, rows = IS_AFFINE(matrix) ? 2 : 3;
+
+    /* Columns 0 and 1 are scaled. */
+    for (row = 0; row < rows; row++) {
+        matrix->m[row][0] *= scale_x;
+        matrix->m[row][1] *= scale_y;
+    }
+
     return VG_LITE_SUCCESS;
 }
 
@@ -96,6 +157,8 @@ vg_lite_error_t vg_lite_rotate(vg_lite_float_t degrees, vg_lite_matrix_t * matri
 #ifndef M_PI
 #define M_PI 3.1415926f
 #endif
+    int row, rows = IS_AFFINE(matrix) ? 2 : 3;
+
     /* Convert degrees into radians. */
     vg_lite_float_t angle = degrees / 180.0f * M_PI;
 
@@ -103,25 +166,263 @@ vg_lite_error_t vg_lite_rotate(vg_lite_float_t degrees, vg_lite_matrix_t * matri
     vg_lite_float_t cos_angle = cosf(angle);
     vg_lite_float_t sin_angle = sinf(angle);
 
-    /* Set rotation matrix. */
-    vg_lite_matrix_t r = { { {cos_angle, -sin_angle, 0.0f},
-        {sin_angle, cos_angle, 0.0f},
-        {0.0f, 0.0f, 1.0f}
-    } };
+    /* Columns 0 and 1 are rotated. */
+    for (row = 0; row < rows; row++) {
+        vg_lite_float_t m0 = matrix->m[row][0];
+        vg_lite_float_t m1 = matrix->m[row][1];
+
+        matrix->m[row][0] = (m0 * cos_angle) + (m1 * sin_angle);
+        matrix->m[row][1] = (m0 * -sin_angle) + (m1 * cos_angle);
+    }
 
-    /* Multiply with current matrix. */
-    multiply(matrix, &r);
     return VG_LITE_SUCCESS;
 }
 
 vg_lite_error_t vg_lite_perspective(vg_lite_float_t px, vg_lite_float_t py, vg_lite_matrix_t * matrix)
 {
-    /* set prespective matrix */
-    vg_lite_matrix_t p = { { {1.0f, 0.0f, 0.0f},
-        {0.0f, 1.0f, 0.0f},
-        {px, py, 1.0f}
-    } };
-    /* Multiply with current matrix. */
-    multiply(matrix, &p);
+    int row;
+
+    /* Columns 0 and 1 pick up column 2 times the perspective factors. */
+    for (row = 0; row < 3; row++) {
+        matrix->m[row][0] = matrix->m[row][0] + (matrix->m[row][2] * px);
+        matrix->m[row][1] = matrix->m[row][1] + (matrix->m[row][2] * py);
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+/* Map the unit square (0,0) (1,0) (1,1) (0,1) onto quad (q), relative to
+ * its first corner. Returns 0 when the quad is degenerate.
+ */
+static int square_to_quad(const vg_lite_point_t * q, double m[3][3])
+{
+    double x1 = q[1].x - q[0].x, y1 = q[1].y - q[0].y;
+    double x2 = q[2].x - q[0].x, y2 = q[2].y - q[0].y;
+    double x3 = q[3].x - q[0].x, y3 = q[3].y - q[0].y;
+    double sx = x2 - x1 - x3;
+    double sy = y2 - y1 - y3;
+    double g = 0.0, h = 0.0;
+
+    if (sx != 0.0 || sy != 0.0) {
+        /* Not a parallelogram, solve for the projective terms. */
+        double dx1 = x1 - x2, dx2 = x3 - x2;
+        double dy1 = y1 - y2, dy2 = y3 - y2;
+        double det = dx1 * dy2 - dx2 * dy1;
+
+        if (det == 0.0)
+            return 0;
+
+        g = (sx * dy2 - dx2 * sy) / det;
+        h = (dx1 * sy - sx * dy1) / det;
+    }
+
+    m[0][0] = x1 + g * x1;
+    m[0][1] = x3 + h * x3;
+    m[0][2] = 0.0;
+    m[1][0] = y1 + g * y1;
+    m[1][1] = y3 + h * y3;
+    m[1][2] = 0.0;
+    m[2][0] = g;
+    m[2][1] = h;
+    m[2][2] = 1.0;
+
+    return m[0][0] * m[1][1] - m[0][1] * m[1][0] != 0.0;
+}
+
+static int is_parallelogram(const vg_lite_point_t * q)
+{
+    return q[0].x + q[2].x == q[1].x + q[3].x && q[0].y + q[2].y == q[1].y + q[3].y;
+}
+
+vg_lite_error_t vg_lite_get_transform_matrix(vg_lite_point4_t src, vg_lite_point4_t dst, vg_lite_matrix_t * mat)
+{
+    double s[3][3], d[3][3], inv[3][3], r[3][3];
+    double w[4], det;
+    int row, column;
+
+    if (!src || !dst || !mat)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    if (!square_to_quad(src, s) || !square_to_quad(dst, d))
+        return VG_LITE_INVALID_ARGUMENT;
+
+    if (is_parallelogram(src) && is_parallelogram(dst)) {
+        /* Affine: inverse of the 2x2 part of the source map. */
+        det = s[0][0] * s[1][1] - s[0][1] * s[1][0];
+        inv[0][0] = s[1][1] / det;
+        inv[0][1] = -s[0][1] / det;
+        inv[1][0] = -s[1][0] / det;
+        inv[1][1] = s[0][0] / det;
+
+        for (row = 0; row < 2; row++)
+            for (column = 0; column < 2; column++)
+                r[row][column] = d[row][0] * inv[0][column] + d[row][1] * inv[1][column];
+
+        r[0][2] = r[1][2] = 0.0;
+        r[2][0] = r[2][1] = 0.0;
+        r[2][2] = 1.0;
+    } else {
+        /* Projective: dst map times the adjugate of the src map, the
+         * scale of the inverse cancels out in homogeneous coordinates. */
+        inv[0][0] = s[1][1] * s[2][2] - s[1][2] * s[2][1];
+        inv[0][1] = s[0][2] * s[2][1] - s[0][1] * s[2][2];
+        inv[0][2] = s[0][1] * s[1][2] - s[0][2] * s[1][1];
+        inv[1][0] = s[1][2] * s[2][0] - s[1][0] * s[2][2];
+        inv[1][1] = s[0][0] * s[2][2] - s[0][2] * s[2][0];
+        inv[1][2] = s[0][2] * s[1][0] - s[0][0] * s[1][2];
+        inv[2][0] = s[1][0] * s[2][1] - s[1][1] * s[2][0];
+        inv[2][1] = s[0][1] * s[2][0] - s[0][0] * s[2][1];
+        inv[2][2] = s[0][0] * s[1][1] - s[0][1] * s[1][0];
+
+        for (row = 0; row < 3; row++)
+            for (column = 0; column < 3; column++)
+                r[row][column] = d[row][0] * inv[0][column]
+                    + d[row][1] * inv[1][column]
+                    + d[row][2] * inv[2][column];
+
+        if (r[2][2] == 0.0)
+            return VG_LITE_INVALID_ARGUMENT;
+
+        for (row = 0; row < 3; row++)
+            for (column = 0; column < 3; column++)
+                r[row][column] /= r[2][2];
+    }
+
+    /* Both maps are relative to the first corners:
+     * mat = translate(dst[0]) * r * translate(-src[0]). */
+    for (row = 0; row < 3; row++)
+        r[row][2] -= r[row][0] * src[0].x + r[row][1] * src[0].y;
+
+    for (column = 0; column < 3; column++) {
+        r[0][column] += dst[0].x * r[2][column];
+        r[1][column] += dst[0].y * r[2][column];
+    }
+
+    /* A quad folded across the horizon has no finite image. */
+    for (row = 0; row < 4; row++) {
+        w[row] = r[2][0] * src[row].x + r[2][1] * src[row].y + r[2][2];
+        if (w[row] * w[0] <= 0.0)
+            return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    for (row = 0; row < 3; row++)
+        for (column = 0; column < 3; column++)
+            mat->m[row][column] = (vg_lite_float_t)(r[2][2] != 0.0 ? r[row][column] / r[2][2] : r[row][column]);
+
+    return VG_LITE_SUCCESS;
+}
+
+/* Both kernels sum in the same order, the SIMD loops only handle two points
+ * at a time. The NEON multiplies and adds stay separate, a fused
+ * multiply-add would round differently from the scalar loop. */
+static void transform_affine(const vg_lite_matrix_t * matrix, const vg_lite_float_t * src, vg_lite_float_t * dst, vg_lite_uint32_t count)
+{
+    const vg_lite_float_t (*m)[3] = matrix->m;
+    vg_lite_uint32_t i = 0;
+
+#if defined(__SSE2__)
+    __m128 m0 = _mm_setr_ps(m[0][0], m[1][0], m[0][0], m[1][0]);
+    __m128 m1 = _mm_setr_ps(m[0][1], m[1][1], m[0][1], m[1][1]);
+    __m128 m2 = _mm_setr_ps(m[0][2], m[1][2], m[0][2], m[1][2]);
+
+    for (; i + 2 <= count; i += 2) {
+        __m128 p = _mm_loadu_ps(src + i * 2);
+        __m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+        _mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m1)), m2));
+    }
+#elif defined(__ARM_NEON)
+    const vg_lite_float_t c0[4] = { m[0][0], m[1][0], m[0][0], m[1][0] };
+    const vg_lite_float_t c1[4] = { m[0][1], m[1][1], m[0][1], m[1][1] };
+    const vg_lite_float_t c2[4] = { m[0][2], m[1][2], m[0][2], m[1][2] };
+    float32x4_t m0 = vld1q_f32(c0);
+    float32x4_t m1 = vld1q_f32(c1);
+    float32x4_t m2 = vld1q_f32(c2);
+
+    for (; i + 2 <= count; i += 2) {
+        /* x0 x0 x1 x1 and y0 y0 y1 y1 */
+        float32x4x2_t xy = vtrnq_f32(vld1q_f32(src + i * 2), vld1q_f32(src + i * 2));
+        vst1q_f32(dst + i * 2, vaddq_f32(vaddq_f32(vmulq_f32(xy.val[0], m0), vmulq_f32(xy.val[1], m1)), m2));
+    }
+#endif
+
+    for (; i < count; i++) {
+        vg_lite_float_t x = src[i * 2];
+        vg_lite_float_t y = src[i * 2 + 1];
+        dst[i * 2] = x * m[0][0] + y * m[0][1] + m[0][2];
+        dst[i * 2 + 1] = x * m[1][0] + y * m[1][1] + m[1][2];
+    }
+}
+
+static void transform_perspective(const vg_lite_matrix_t * matrix, const vg_lite_float_t * src, vg_lite_float_t * dst, vg_lite_uint32_t count)
+{
+    const vg_lite_float_t (*m)[3] = matrix->m;
+    vg_lite_uint32_t i = 0;
+
+#if defined(__SSE2__)
+    __m128 m0 = _mm_setr_ps(m[0][0], m[1][0], m[0][0], m[1][0]);
+    __m128 m1 = _mm_setr_ps(m[0][1], m[1][1], m[0][1], m[1][1]);
+    __m128 m2 = _mm_setr_ps(m[0][2], m[1][2], m[0][2], m[1][2]);
+    __m128 w0 = _mm_set1_ps(m[2][0]);
+    __m128 w1 = _mm_set1_ps(m[2][1]);
+    __m128 w2 = _mm_set1_ps(m[2][2]);
+
+    for (; i + 2 <= count; i += 2) {
+        __m128 p = _mm_loadu_ps(src + i * 2);
+        __m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 uv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m1)), m2);
+        __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, w0), _mm_mul_ps(y, w1)), w2);
+        _mm_storeu_ps(dst + i * 2, _mm_div_ps(uv, w));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    /* 32-bit NEON has no exact division, it keeps the scalar loop */
+    const vg_lite_float_t c0[4] = { m[0][0], m[1][0], m[0][0], m[1][0] };
+    const vg_lite_float_t c1[4] = { m[0][1], m[1][1], m[0][1], m[1][1] };
+    const vg_lite_float_t c2[4] = { m[0][2], m[1][2], m[0][2], m[1][2] };
+    float32x4_t m0 = vld1q_f32(c0);
+    float32x4_t m1 = vld1q_f32(c1);
+    float32x4_t m2 = vld1q_f32(c2);
+    float32x4_t w0 = vdupq_n_f32(m[2][0]);
+    float32x4_t w1 = vdupq_n_f32(m[2][1]);
+    float32x4_t w2 = vdupq_n_f32(m[2][2]);
+
+    for (; i + 2 <= count; i += 2) {
+        float32x4x2_t xy = vtrnq_f32(vld1q_f32(src + i * 2), vld1q_f32(src + i * 2));
+        float32x4_t uv = vaddq_f32(vaddq_f32(vmulq_f32(xy.val[0], m0), vmulq_f32(xy.val[1], m1)), m2);
+        float32x4_t w = vaddq_f32(vaddq_f32(vmulq_f32(xy.val[0], w0), vmulq_f32(xy.val[1], w1)), w2);
+        vst1q_f32(dst + i * 2, vdivq_f32(uv, w));
+    }
+#endif
+
+    for (; i < count; i++) {
+        vg_lite_float_t x = src[i * 2];
+        vg_lite_float_t y = src[i * 2 + 1];
+        vg_lite_float_t w = x * m[2][0] + y * m[2][1] + m[2][2];
+        dst[i * 2] = (x * m[0][0] + y * m[0][1] + m[0][2]) / w;
+        dst[i * 2 + 1] = (x * m[1][0] + y * m[1][1] + m[1][2]) / w;
+    }
+}
+
+vg_lite_error_t vg_lite_tvg_transform_points(const vg_lite_matrix_t * matrix, const vg_lite_float_t * src, vg_lite_float_t * dst, vg_lite_uint32_t count)
+{
+    if (!matrix || !src || !dst)
+        return VG_LITE_INVALID_ARGUMENT;
+
+    switch (vg_lite_tvg_matrix_classify(matrix)) {
+    case VG_LITE_TVG_MATRIX_IDENTITY:
+        if (src != dst)
+            memmove(dst, src, count * 2 * sizeof(vg_lite_float_t));
+        break;
+
+    case VG_LITE_TVG_MATRIX_PERSPECTIVE:
+        transform_perspective(matrix, src, dst, count);
+        break;
+
+    default:
+        transform_affine(matrix, src, dst, count);
+        break;
+    }
+
     return VG_LITE_SUCCESS;
 }
@@ -7,12 +7,18 @@
  *      INCLUDES
  *********************/
 
-#include "vg_lite.h"
+#include "vg_lite_tvg.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <float.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <thorvg.h>
 #include <thread>
 #include <vector>
@@ -21,6 +27,10 @@
 #include <libyuv/convert_argb.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __NuttX__
 #include <nuttx/config.h>
 #include <syslog.h>
@@ -37,6 +47,8 @@
 // #define CONFIG_VG_LITE_TVG_16PIXELS_ALIGN
 // #define CONFIG_VG_LITE_TVG_THREAD_RENDER
 // #define CONFIG_VG_LITE_TVG_TRACE_API
+// #define CONFIG_VG_LITE_TVG_GRAD_SAMPLE_RAMP
+// #define CONFIG_VG_LITE_TVG_LINEAR_BLEND
 
 #ifndef CONFIG_VG_LITE_TVG_BUF_ADDR_ALIGN
 #define CONFIG_VG_LITE_TVG_BUF_ADDR_ALIGN 64
@@ -53,6 +65,36 @@
 #define TVG_COLOR(COLOR) B(COLOR), G(COLOR), R(COLOR), A(COLOR)
 #define TVG_IS_VG_FMT_SUPPORT(fmt) ((fmt) == VG_LITE_BGRA8888 || (fmt) == VG_LITE_BGRX8888)
 
+/* Curve flattening tolerance (device pixels) of each path quality. */
+#define PATH_FLATTEN_TOLERANCE_LOW 1.0f
+#define PATH_FLATTEN_TOLERANCE_MEDIUM 0.5f
+#define PATH_FLATTEN_TOLERANCE_UPPER 0.25f
+#define PATH_FLATTEN_MAX_SEGMENTS 64
+
+/* Header magic of the single entry packs allocated by vg_lite_tvg_path_bake(),
+ * "VTVB". Only these are freed by vg_lite_tvg_path_bake_free(). */
+#define PATH_BAKE_MAGIC 0x42565456
+
+/* Intermediate color stops per premultiplied ramp segment. */
+#define GRAD_FILL_PREMULTIPLY_STEPS 8
+
+/* How far the gradient geometry is extended past the ramp ends to leave room
+ * for paint_color in VG_LITE_GRADIENT_SPREAD_FILL, in units of the ramp length.
+ * One entry of the ThorVG color table. */
+#define GRAD_FILL_SPREAD_FILL_MARGIN (1.0f / 1024)
+
+/* Device pixels between exact divides of the projective image sampler. */
+#define PICTURE_WARP_SPAN 16
+
+/* Pixels per side of the tiles quarter turns are done in, both tiles stay in the cache. */
+#define PICTURE_ROTATE_TILE 32
+
+/* Target rows a rotated canvas is turned in at a time before the resolve. */
+#define PICTURE_RESOLVE_BAND 16
+
+/* Decoded and filtered images kept across frames. */
+#define PICTURE_CACHE_SIZE 16
+
 #define TVG_CHECK_RETURN_VG_ERROR(FUNC)                               \
     do {                                                              \
         Result res = FUNC;                                            \
@@ -145,18 +187,211 @@ typedef struct {
 
 #pragma pack()
 
+/* Parsed path and the rasterization state selected by vg_lite_quality_t. */
+typedef struct path_raster {
+    const vg_lite_matrix_t* matrix;
+    vg_lite_tvg_matrix_type_t matrix_type;
+    float scale; /* approximate device scale of the matrix */
+    float tolerance; /* flattening tolerance in device pixels, 0: keep curves */
+    bool snap; /* snap vertices to the device pixel grid (aliased fill) */
+    float cur_x, cur_y;
+    float start_x, start_y;
+    float bounds[4]; /* bounds of the emitted points: left, top, right, bottom */
+    std::vector<PathCommand> cmds;
+    std::vector<Point> pts;
+
+    /* parsed path handed to ThorVG, the vectors above or a mapped path pack */
+    const PathCommand* cmd_data;
+    uint32_t cmd_count;
+    const Point* pt_data;
+    uint32_t pt_count;
+} path_raster_t;
+
+typedef enum {
+    GRAD_RAMP_LINEAR, /* fills the texels [0, width) */
+    GRAD_RAMP_RADIAL, /* fills the whole stride */
+} grad_ramp_kind_t;
+
+/* Gradient color ramp image shared by all gradients with the same ramp. */
+typedef struct {
+    uint32_t hash;
+    uint32_t ref_count;
+    std::vector<uint8_t> key; /* kind, widths, flags and color ramp the image was built from */
+    vg_lite_buffer_t image;
+} grad_ramp_t;
+
+/* vg_lite_set_pixel_matrix() in 4.12 fixed point. Rows are the outputs and
+ * columns the inputs, both in the A, R, G, B order of the API, the last column
+ * is the offset.
+ */
+typedef struct {
+    int16_t m[4][5];
+    bool enable[4]; /* rows to apply, identity rows are left out */
+    bool premultiplied; /* alpha kept or scaled down, so premultiplied pixels transform directly */
+} pixel_matrix_t;
+
+/* Per row steps of picture_decode(), nullptr when not in effect. */
+typedef struct {
+    bool premultiply; /* straight source pixels, premultiplied after the color key */
+    const vg_lite_color_key_t* color_key;
+    const uint8_t* gamma; /* 256 entry table of the color channels */
+    const pixel_matrix_t* pixel_matrix;
+    const pixel_matrix_t* color_transform;
+    const uint8_t* global_alpha; /* alpha that replaces the source alpha */
+} picture_line_ops_t;
+
+/* Rendered canvas read by the resolve of vg_lite_finish(), row by row of the target. */
+typedef struct {
+    const uint32_t* src;
+    uint32_t width; /* of the target */
+    uint32_t height;
+    bool mirror; /* VG_LITE_ORIENTATION_BOTTOM_TOP */
+    uint32_t quarter; /* clockwise quarter turns from the canvas to the target */
+    uint32_t stride; /* bytes between the target rows */
+    uint32_t x0, y0, x1, y1; /* target pixels resolved, the drawn canvas pixels turned */
+    uint32_t* band; /* PICTURE_RESOLVE_BAND turned target rows, x0 to x1 */
+    uint32_t band_y; /* first target row in (band) */
+    uint32_t band_rows; /* 0 until (band) is filled */
+    const uint8_t* gamma; /* linear to sRGB table while blending linearly */
+    bool straight; /* the target takes straight alpha */
+    uint32_t* line; /* one target row, x0 to x1, through (gamma) and (straight) */
+} picture_resolve_t;
+
+typedef enum {
+    PICTURE_CACHE_DECODE, /* decoded through the picture_line_ops_t */
+    PICTURE_CACHE_GAUSS, /* filtered for VG_LITE_FILTER_GAUSSIAN */
+} picture_cache_kind_t;
+
+/* Image built from a source image, kept across frames while its key matches. */
+typedef struct {
+    picture_cache_kind_t kind;
+    const void* memory;
+    uint32_t width;
+    uint32_t height;
+    uint64_t key; /* hash of the input pixels and of all state the result depends on */
+    uint32_t frame; /* last frame the image was drawn in */
+    std::vector<uint32_t> bits;
+} picture_cache_t;
+
+/* Gradient fill with its color stops, duplicated for each draw of the gradient. */
+typedef struct {
+    const void* grad;
+    vg_lite_color_t paint_color; /* outer color of VG_LITE_GRADIENT_SPREAD_FILL */
+    std::unique_ptr<Fill> fill;
+} grad_fill_t;
+
+/* Source image of a projective blit or of a pattern, see picture_warp(). */
+typedef struct {
+    const uint32_t* bits;
+    int32_t stride; /* in pixels */
+    int32_t clip[4]; /* source pixels that can be sampled: left, top, right, bottom */
+    double inv[3][3]; /* device to source */
+    bool bilinear;
+    vg_lite_pattern_mode_t mode; /* addressing of the pixels outside of (clip) */
+    uint32_t border; /* premultiplied color outside of (clip) with VG_LITE_PATTERN_COLOR */
+    int32_t period[2]; /* 16.16 period of VG_LITE_PATTERN_REPEAT and REFLECT, 0 otherwise or beyond 16.16 */
+} picture_warp_t;
+
+/* Consecutive vg_lite_draw() calls merged into one shape. */
+typedef struct {
+    std::unique_ptr<Shape> shape; /* pushed to the canvas once no more paths are merged */
+    void* target;
+    vg_lite_fill_t fill_rule;
+    vg_lite_blend_t blend;
+    vg_lite_color_t color;
+    vg_lite_matrix_t matrix;
+    int32_t bounds[4]; /* device pixels touched by the merged paths */
+} draw_batch_t;
+
 class vg_lite_ctx {
 public:
     std::unique_ptr<SwCanvas> canvas;
     void* target_buffer;
+    uint32_t* direct_buffer; /* target drawn in place, kept for the destination alpha */
     uint32_t target_px_size;
+    uint32_t target_width;
+    uint32_t target_stride; /* pixels between the canvas rows */
+    uint32_t target_buffer_stride; /* bytes between the rows of target_buffer */
     vg_lite_buffer_format_t target_format;
+    vg_lite_tvg_stats_t stats;
+
+    /* canvas pixels the paints pushed since vg_lite_finish() may touch, empty when x0 >= x1 */
+    int32_t drawn[4];
+
+    /* vg_lite_source_global_alpha() and vg_lite_dest_global_alpha() */
+    vg_lite_global_alpha_t src_alpha_mode;
+    uint8_t src_alpha_value;
+    vg_lite_global_alpha_t dst_alpha_mode;
+    uint8_t dst_alpha_value;
+
+    /* ordered dither when resolving to 16-bit targets */
+    bool dither_enabled;
+
+    /* vg_lite_set_mirror(), bottom to top targets are flipped while resolving */
+    vg_lite_orientation_t orientation;
+
+    /* vg_lite_tvg_set_rotation(), the canvas is turned onto the target while resolving */
+    vg_lite_tvg_rotation_t rotation;
+    uint32_t canvas_width; /* target size in paint coordinates */
+    uint32_t canvas_height;
+
+    /* vg_lite_set_gamma() for source images, and vg_lite_tvg_set_linear_blend() */
+    vg_lite_gamma_conversion_t gamma;
+    bool linear_blend;
+
+    /* vg_lite_set_premultiply(), straight pixels are premultiplied while decoding and resolving */
+    bool src_premultiplied;
+    bool dst_premultiplied;
+
+    /* vg_lite_gaussian_filter() weights w0, w1, w2 in 8-bit fixed point, summing to 256 */
+    int32_t gauss_weights[3];
 
 public:
     vg_lite_ctx()
         : target_buffer { nullptr }
+        , direct_buffer { nullptr }
         , target_px_size { 0 }
+        , target_width { 0 }
+        , target_stride { 0 }
+        , target_buffer_stride { 0 }
         , target_format { VG_LITE_BGRA8888 }
+        , stats { 0 }
+        , drawn { 0, 0, 0, 0 }
+        , src_alpha_mode { VG_LITE_NORMAL }
+        , src_alpha_value { 0xff }
+        , dst_alpha_mode { VG_LITE_NORMAL }
+        , dst_alpha_value { 0xff }
+        , dither_enabled { false }
+        , orientation { VG_LITE_ORIENTATION_TOP_BOTTOM }
+        , rotation { VG_LITE_TVG_ROTATION_0 }
+        , canvas_width { 0 }
+        , canvas_height { 0 }
+        , gamma { VG_LITE_GAMMA_NO_CONVERSION }
+        , linear_blend { false }
+        , src_premultiplied { true }
+        , dst_premultiplied { true }
+        , gauss_weights { 64, 32, 16 }
+        , batch {}
+        , canvas_image_count { 0 }
+        , picture_cache_frame { 0 }
+        , scissor_enabled { false }
+        , mask { 0 }
+        , mask_enabled { false }
+        , mask_image { nullptr }
+        , color_key { { 0 } }
+        , color_key_enabled { false }
+        , pixel_matrix { { { 0 } } }
+        , pixel_matrix_enabled { false }
+        , color_transform { 1, 0, 1, 0, 1, 0, 1, 0 }
+        , color_transform_matrix { { { 0 } } }
+        , color_transform_enabled { false }
+        , color_transform_active { false }
+        , image_gamma { 0 }
+        , image_gamma_enabled { false }
+        , paint_gamma { 0 }
+        , paint_gamma_enabled { false }
+        , resolve_gamma { 0 }
+        , resolve_gamma_enabled { false }
         , clut_2colors { 0 }
         , clut_4colors { 0 }
         , clut_16colors { 0 }
@@ -190,6 +425,101 @@ public:
         return dest_buffer.data();
     }
 
+    /* Rows of a rotated canvas turned for the resolve, and one more row. */
+    uint32_t* get_resolve_band(uint32_t w)
+    {
+        resolve_band.resize(w * (PICTURE_RESOLVE_BAND + 1));
+        return resolve_band.data();
+    }
+
+    /* Three rows of the horizontal Gaussian pass, four channels per pixel. */
+    uint16_t* get_gauss_rows(uint32_t w)
+    {
+        gauss_rows.resize(w * 4 * 3);
+        return gauss_rows.data();
+    }
+
+    /* Opacity of image paints, ThorVG scales the source alpha without touching the
+     * pixels. VG_LITE_GLOBAL replaces the alpha, which picture_decode() does.
+     */
+    uint8_t get_source_opacity() const
+    {
+        return src_alpha_mode == VG_LITE_SCALED ? src_alpha_value : 0xff;
+    }
+
+    /* Alpha every source image pixel takes, nullptr unless VG_LITE_GLOBAL. */
+    const uint8_t* get_source_global_alpha() const
+    {
+        return src_alpha_mode == VG_LITE_GLOBAL ? &src_alpha_value : nullptr;
+    }
+
+    /* Images built for a paint, referenced by the canvas until vg_lite_finish(). */
+    uint32_t* get_canvas_image(uint32_t w, uint32_t h)
+    {
+        if (canvas_image_count == canvas_images.size()) {
+            canvas_images.emplace_back();
+        }
+
+        auto& buffer = canvas_images[canvas_image_count++];
+        buffer.resize(w * h);
+        return buffer.data();
+    }
+
+    void release_canvas_images()
+    {
+        canvas_image_count = 0;
+        mask_image = nullptr;
+
+        /* cached images are referenced by the canvas too, drop the least recent ones now */
+        while (picture_caches.size() > PICTURE_CACHE_SIZE) {
+            auto oldest = picture_caches.begin();
+            for (auto it = picture_caches.begin(); it != picture_caches.end(); ++it) {
+                if (it->frame < oldest->frame) {
+                    oldest = it;
+                }
+            }
+            picture_caches.erase(oldest);
+        }
+        picture_cache_frame++;
+    }
+
+    /* Image of (kind) built from the image at (memory), nullptr if none matches (key). */
+    uint32_t* find_picture_cache(picture_cache_kind_t kind, const void* memory, uint32_t w, uint32_t h, uint64_t key)
+    {
+        for (auto& image : picture_caches) {
+            if (image.kind == kind && image.memory == memory && image.width == w && image.height == h && image.key == key) {
+                image.frame = picture_cache_frame;
+                return image.bits.data();
+            }
+        }
+        return nullptr;
+    }
+
+    /* Storage for a new image, replacing the outdated one of the same (kind) and (memory). */
+    uint32_t* add_picture_cache(picture_cache_kind_t kind, const void* memory, uint32_t w, uint32_t h, uint64_t key)
+    {
+        picture_cache_t* image = nullptr;
+        for (auto& it : picture_caches) {
+            if (it.kind == kind && it.memory == memory && it.frame != picture_cache_frame) {
+                image = &it;
+                break;
+            }
+        }
+        if (!image) {
+            picture_caches.emplace_back();
+            image = &picture_caches.back();
+        }
+
+        image->kind = kind;
+        image->memory = memory;
+        image->width = w;
+        image->height = h;
+        image->key = key;
+        image->frame = picture_cache_frame;
+        image->bits.resize(w * h);
+        return image->bits.data();
+    }
+
     void set_CLUT(uint32_t count, const uint32_t* colors)
     {
         switch (count) {
@@ -234,6 +564,338 @@ public:
         return nullptr;
     }
 
+    path_raster_t* get_path_raster()
+    {
+        return &path_raster;
+    }
+
+    std::vector<grad_ramp_t>* get_grad_ramps()
+    {
+        return &grad_ramps;
+    }
+
+    std::vector<grad_fill_t>* get_grad_fills()
+    {
+        return &grad_fills;
+    }
+
+    /* All paints go through here, so nothing lands between merged draws.
+     * (clip) can be false when the paint is known to be inside the scissor.
+     */
+    Result push(std::unique_ptr<Paint> paint, bool clip = true);
+
+    void set_scissor(const vg_lite_rectangle_t* rects, uint32_t count)
+    {
+        batch_end();
+        scissor.assign(rects, rects + count);
+    }
+
+    void enable_scissor(bool enable)
+    {
+        batch_end();
+        scissor_enabled = enable;
+    }
+
+    /* Whether any pixel of (bounds) passes the scissor test, and whether
+     * the paint has to be clipped to keep the others out.
+     */
+    bool scissor_test(const int32_t bounds[4], bool* clip) const
+    {
+        *clip = false;
+        if (!scissor_enabled) {
+            return true;
+        }
+
+        bool visible = false;
+        for (auto& rect : scissor) {
+            int32_t right = rect.x + rect.width;
+            int32_t bottom = rect.y + rect.height;
+
+            if (bounds[0] >= rect.x && bounds[1] >= rect.y && bounds[2] <= right && bounds[3] <= bottom) {
+                return true;
+            }
+
+            if (bounds[0] < right && bounds[2] > rect.x && bounds[1] < bottom && bounds[3] > rect.y) {
+                visible = true;
+            }
+        }
+
+        *clip = visible;
+        return visible;
+    }
+
+    /* Active mask layer, applied to all paints while enabled. */
+    void set_mask(const vg_lite_buffer_t* masklayer)
+    {
+        batch_end();
+        if (masklayer) {
+            mask = *masklayer;
+        } else {
+            memset(&mask, 0, sizeof(mask));
+        }
+        mask_image = nullptr;
+    }
+
+    void enable_mask(bool enable)
+    {
+        batch_end();
+        mask_enabled = enable;
+    }
+
+    /* Called before the mask layer at (memory) is written, the pending batch
+     * is pushed with the mask it was drawn with.
+     */
+    void mask_write_begin(const void* memory)
+    {
+        if (memory == mask.memory) {
+            batch_end();
+        }
+    }
+
+    /* Called after the mask layer at (memory) was written. */
+    void mask_changed(const void* memory)
+    {
+        if (memory == mask.memory) {
+            mask_image = nullptr;
+        }
+    }
+
+    const vg_lite_buffer_t* get_mask() const
+    {
+        return mask_enabled && mask.memory ? &mask : nullptr;
+    }
+
+    /* Whether (memory) is the stored mask layer, enabled or not. */
+    bool is_mask(const void* memory) const
+    {
+        return memory && memory == mask.memory;
+    }
+
+    /* ARGB copy of the mask for the ThorVG alpha mask, nullptr once the mask changed. */
+    const uint32_t* get_mask_image() const
+    {
+        return mask_image;
+    }
+
+    void set_mask_image(const uint32_t* image)
+    {
+        mask_image = image;
+    }
+
+    /* Images are decoded when drawn, so pending paints keep their keys. */
+    void set_color_key(const vg_lite_color_key4_t keys)
+    {
+        memcpy(color_key, keys, sizeof(color_key));
+        color_key_enabled = false;
+        for (int i = 0; i < 4; i++) {
+            color_key_enabled |= color_key[i].enable != 0;
+        }
+    }
+
+    const vg_lite_color_key_t* get_color_key() const
+    {
+        return color_key_enabled ? color_key : nullptr;
+    }
+
+    void set_pixel_matrix(const pixel_matrix_t* matrix)
+    {
+        pixel_matrix_enabled = matrix != nullptr;
+        if (matrix) {
+            pixel_matrix = *matrix;
+        }
+    }
+
+    const pixel_matrix_t* get_pixel_matrix() const
+    {
+        return pixel_matrix_enabled ? &pixel_matrix : nullptr;
+    }
+
+    void enable_color_transform(bool enable)
+    {
+        color_transform_enabled = enable;
+    }
+
+    /* (matrix) is the diagonal form of (values), nullptr for the identity. */
+    void set_color_transform(const vg_lite_color_transform_t* values, const pixel_matrix_t* matrix)
+    {
+        color_transform = *values;
+        color_transform_active = matrix != nullptr;
+        if (matrix) {
+            color_transform_matrix = *matrix;
+        }
+    }
+
+    const pixel_matrix_t* get_color_transform() const
+    {
+        return color_transform_enabled && color_transform_active ? &color_transform_matrix : nullptr;
+    }
+
+    /* Gamma tables of source images, of paint colors and of the resolve, nullptr
+     * when not converted. The canvas holds linear light while blending linearly.
+     */
+    void set_gamma_tables(const uint8_t* image, const uint8_t* paint, const uint8_t* resolve)
+    {
+        image_gamma_enabled = image != nullptr;
+        if (image) {
+            memcpy(image_gamma, image, sizeof(image_gamma));
+        }
+        paint_gamma_enabled = paint != nullptr;
+        if (paint) {
+            memcpy(paint_gamma, paint, sizeof(paint_gamma));
+        }
+        resolve_gamma_enabled = resolve != nullptr;
+        if (resolve) {
+            memcpy(resolve_gamma, resolve, sizeof(resolve_gamma));
+        }
+    }
+
+    const uint8_t* get_image_gamma() const
+    {
+        return image_gamma_enabled ? image_gamma : nullptr;
+    }
+
+    const uint8_t* get_resolve_gamma() const
+    {
+        return resolve_gamma_enabled ? resolve_gamma : nullptr;
+    }
+
+    /* Table the target pixels take into the canvas, the paint colors' one. */
+    const uint8_t* get_canvas_gamma() const
+    {
+        return paint_gamma_enabled ? paint_gamma : nullptr;
+    }
+
+    /* (color) in the light of the canvas. */
+    vg_lite_color_t get_canvas_color(vg_lite_color_t color) const
+    {
+        if (!paint_gamma_enabled) {
+            return color;
+        }
+
+        /* alpha is the high byte and stays */
+        return (color & 0xFF000000) | ((vg_lite_color_t)paint_gamma[(color >> 16) & 0xFF] << 16)
+            | ((vg_lite_color_t)paint_gamma[(color >> 8) & 0xFF] << 8) | paint_gamma[color & 0xFF];
+    }
+
+    /* Paint (color) through the color transform, once per paint. */
+    vg_lite_color_t get_paint_color(vg_lite_color_t color) const
+    {
+        if (!get_color_transform()) {
+            return get_canvas_color(color);
+        }
+
+        /* vg_lite_color_t holds R in the low byte */
+        const vg_lite_float_t scale[4] = { color_transform.r_scale, color_transform.g_scale, color_transform.b_scale, color_transform.a_scale };
+        const vg_lite_float_t bias[4] = { color_transform.r_bias, color_transform.g_bias, color_transform.b_bias, color_transform.a_bias };
+        vg_lite_color_t result = 0;
+        for (int i = 0; i < 4; i++) {
+            vg_lite_float_t value = ((color >> (i * 8)) & 0xFF) * scale[i] + bias[i] * 255;
+            result |= (vg_lite_color_t)lroundf(CLAMP(value, 0.0f, 255.0f)) << (i * 8);
+        }
+        return get_canvas_color(result);
+    }
+
+    /* Render target of vg_lite_render_masklayer(), drawn right away. */
+    SwCanvas* get_mask_canvas(uint32_t w, uint32_t h, uint32_t** buffer)
+    {
+        if (!mask_canvas) {
+            mask_canvas = SwCanvas::gen();
+        }
+
+        mask_buffer.resize(w * h);
+        *buffer = mask_buffer.data();
+        return mask_canvas.get();
+    }
+
+    /* Intersect (bounds) with the extent of the scissor rectangles. */
+    void scissor_bounds(int32_t bounds[4]) const
+    {
+        if (!scissor_enabled) {
+            return;
+        }
+
+        int32_t extent[4] = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+        for (auto& rect : scissor) {
+            extent[0] = MIN(extent[0], rect.x);
+            extent[1] = MIN(extent[1], rect.y);
+            extent[2] = MAX(extent[2], rect.x + rect.width);
+            extent[3] = MAX(extent[3], rect.y + rect.height);
+        }
+
+        bounds[0] = MAX(bounds[0], extent[0]);
+        bounds[1] = MAX(bounds[1], extent[1]);
+        bounds[2] = MIN(bounds[2], extent[2]);
+        bounds[3] = MIN(bounds[3], extent[3]);
+    }
+
+    /* Try to merge the path into the last drawn shape. Paths are only merged
+     * when their pixels don't overlap anything already in the batch, so the
+     * fill rule, blending and anti-aliasing give the same result as separate
+     * shapes.
+     */
+    bool batch_merge(const vg_lite_buffer_t* target, vg_lite_fill_t fill_rule, const vg_lite_matrix_t* matrix,
+        vg_lite_blend_t blend, vg_lite_color_t color, const int32_t bounds[4])
+    {
+        if (!batch.shape
+            || batch.target != target->memory
+            || batch.fill_rule != fill_rule
+            || batch.blend != blend
+            || batch.color != color
+            || memcmp(&batch.matrix, matrix, sizeof(vg_lite_matrix_t)) != 0) {
+            return false;
+        }
+
+        if (bounds[0] < batch.bounds[2] && bounds[2] > batch.bounds[0]
+            && bounds[1] < batch.bounds[3] && bounds[3] > batch.bounds[1]) {
+            return false;
+        }
+
+        batch.bounds[0] = MIN(batch.bounds[0], bounds[0]);
+        batch.bounds[1] = MIN(batch.bounds[1], bounds[1]);
+        batch.bounds[2] = MAX(batch.bounds[2], bounds[2]);
+        batch.bounds[3] = MAX(batch.bounds[3], bounds[3]);
+        return true;
+    }
+
+    Shape* batch_shape()
+    {
+        return batch.shape.get();
+    }
+
+    /* Target of the pending batch, nullptr without one. */
+    const void* batch_target() const
+    {
+        return batch.shape ? batch.target : nullptr;
+    }
+
+    /* Keep (shape) to merge the following paths into, it is pushed by batch_end(). */
+    Result batch_begin(std::unique_ptr<Shape> shape, const vg_lite_buffer_t* target, vg_lite_fill_t fill_rule,
+        const vg_lite_matrix_t* matrix, vg_lite_blend_t blend, vg_lite_color_t color, const int32_t bounds[4])
+    {
+        TVG_CHECK_RETURN_RESULT(batch_end());
+        batch.shape = std::move(shape);
+        batch.target = target->memory;
+        batch.fill_rule = fill_rule;
+        batch.blend = blend;
+        batch.color = color;
+        batch.matrix = *matrix;
+        memcpy(batch.bounds, bounds, sizeof(batch.bounds));
+        return Result::Success;
+    }
+
+    /* Push the pending batch. ThorVG prepares a shape when it is pushed, so
+     * the batch is only handed over once it is complete.
+     */
+    Result batch_end()
+    {
+        if (!batch.shape) {
+            return Result::Success;
+        }
+
+        std::unique_ptr<Paint> shape = std::move(batch.shape);
+        return push(std::move(shape), false);
+    }
+
     static vg_lite_ctx* get_instance()
     {
         static vg_lite_ctx instance;
@@ -244,6 +906,37 @@ private:
     /*  */
     std::vector<uint32_t> src_buffer;
     std::vector<uint32_t> dest_buffer;
+    std::vector<uint32_t> resolve_band;
+    std::vector<uint16_t> gauss_rows;
+    path_raster_t path_raster;
+    draw_batch_t batch;
+    std::vector<grad_ramp_t> grad_ramps;
+    std::vector<grad_fill_t> grad_fills;
+    std::vector<std::vector<uint32_t>> canvas_images;
+    uint32_t canvas_image_count;
+    std::vector<picture_cache_t> picture_caches;
+    uint32_t picture_cache_frame;
+    std::vector<vg_lite_rectangle_t> scissor;
+    bool scissor_enabled;
+    vg_lite_buffer_t mask;
+    bool mask_enabled;
+    const uint32_t* mask_image;
+    std::unique_ptr<SwCanvas> mask_canvas;
+    std::vector<uint32_t> mask_buffer;
+    vg_lite_color_key4_t color_key;
+    bool color_key_enabled;
+    pixel_matrix_t pixel_matrix;
+    bool pixel_matrix_enabled;
+    vg_lite_color_transform_t color_transform;
+    pixel_matrix_t color_transform_matrix;
+    bool color_transform_enabled;
+    bool color_transform_active;
+    uint8_t image_gamma[256];
+    bool image_gamma_enabled;
+    uint8_t paint_gamma[256];
+    bool paint_gamma_enabled;
+    uint8_t resolve_gamma[256];
+    bool resolve_gamma_enabled;
 
     uint32_t clut_2colors[2];
     uint32_t clut_4colors[4];
@@ -251,26 +944,51 @@ private:
     uint32_t clut_256colors[256];
 };
 
+static void picture_decode_line(uint32_t* dst, const uint32_t* src, uint32_t count, const picture_line_ops_t* ops);
+static uint64_t picture_decode_key(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color, const picture_line_ops_t* ops);
+
+static inline bool picture_line_ops_any(const picture_line_ops_t* ops);
+
 template <typename DEST_TYPE, typename SRC_TYPE>
 class vg_lite_converter {
 public:
-    typedef void (*converter_cb_t)(DEST_TYPE* dest, const SRC_TYPE* src, uint32_t px_size, uint32_t color);
+    /* (gamma) is only passed to converters of opaque sources */
+    typedef void (*converter_cb_t)(DEST_TYPE* dest, const SRC_TYPE* src, uint32_t px_size, uint32_t color, const uint8_t* gamma);
 
 public:
-    vg_lite_converter(converter_cb_t converter)
+    vg_lite_converter(converter_cb_t converter, bool opaque = false)
         : _converter_cb(converter)
+        , _opaque(opaque)
     {
     }
 
-    void convert(vg_lite_buffer_t* dest_buf, const vg_lite_buffer_t* src_buf, uint32_t color = 0)
+    /* (ops) are applied to each ARGB row while it is still in cache */
+    void convert(vg_lite_buffer_t* dest_buf, const vg_lite_buffer_t* src_buf, uint32_t color = 0,
+        const picture_line_ops_t* ops = nullptr)
     {
         TVG_ASSERT(_converter_cb);
+        TVG_ASSERT(!ops || sizeof(DEST_TYPE) == sizeof(uint32_t));
         uint8_t* dest = (uint8_t*)dest_buf->memory;
         const uint8_t* src = (const uint8_t*)src_buf->memory;
         uint32_t h = src_buf->height;
 
+        /* opaque colors take the gamma table as they are expanded, unless the
+         * color key has to test them first
+         */
+        const uint8_t* gamma = nullptr;
+        picture_line_ops_t line_ops;
+        if (ops && ops->gamma && _opaque && !ops->color_key) {
+            gamma = ops->gamma;
+            line_ops = *ops;
+            line_ops.gamma = nullptr;
+            ops = picture_line_ops_any(&line_ops) ? &line_ops : nullptr;
+        }
+
         while (h--) {
-            _converter_cb((DEST_TYPE*)dest, (const SRC_TYPE*)src, src_buf->width, color);
+            _converter_cb((DEST_TYPE*)dest, (const SRC_TYPE*)src, src_buf->width, color, gamma);
+            if (ops) {
+                picture_decode_line((uint32_t*)dest, (const uint32_t*)dest, src_buf->width, ops);
+            }
             dest += dest_buf->stride;
             src += src_buf->stride;
         }
@@ -278,6 +996,7 @@ public:
 
 private:
     converter_cb_t _converter_cb;
+    bool _opaque;
 };
 
 typedef vg_lite_float_t FLOATVECTOR4[4];
@@ -290,10 +1009,48 @@ static vg_lite_error_t vg_lite_error_conv(Result result);
 static Matrix matrix_conv(const vg_lite_matrix_t* matrix);
 static FillRule fill_rule_conv(vg_lite_fill_t fill);
 static BlendMethod blend_method_conv(vg_lite_blend_t blend);
-static Result shape_append_path(std::unique_ptr<Shape>& shape, vg_lite_path_t* path, vg_lite_matrix_t* matrix);
-static Result shape_append_rect(std::unique_ptr<Shape>& shape, const vg_lite_buffer_t* target, const vg_lite_rectangle_t* rect);
+static void path_raster_parse(path_raster_t* raster, const vg_lite_path_t* path, const vg_lite_matrix_t* matrix);
+static bool path_raster_need_clip(const path_raster_t* raster, const vg_lite_path_t* path);
+static bool path_raster_device_bounds(const path_raster_t* raster, int32_t bounds[4]);
+static bool device_bounds(const vg_lite_matrix_t* m, vg_lite_tvg_matrix_type_t type, const float rect[4], int32_t bounds[4]);
+static bool draw_visible(vg_lite_ctx* ctx, const int32_t bounds[4], bool* clip);
+static bool mask_area(const vg_lite_buffer_t* masklayer, const vg_lite_rectangle_t* rect, int32_t area[4]);
+static void mask_fill(vg_lite_buffer_t* masklayer, const int32_t area[4], uint8_t value);
+static void mask_blend_span(uint8_t* dst, const uint8_t* src, uint32_t count, vg_lite_mask_operation_t operation);
+static void mask_alpha_span(uint8_t* dst, const uint32_t* src, uint32_t count);
+static void mask_expand_span(uint32_t* dst, const uint8_t* src, uint32_t count);
+static void color_key_span(uint32_t* dst, const uint32_t* src, uint32_t count, const vg_lite_color_key_t* keys, bool premultiply);
+static void picture_gamma_table(uint8_t table[256], vg_lite_gamma_conversion_t conversion);
+static void picture_gamma_update(vg_lite_ctx* ctx);
+static void picture_gamma_span(uint32_t* dst, const uint32_t* src, uint32_t count, const uint8_t* table);
+static void picture_premultiply_span(uint32_t* dst, const uint32_t* src, uint32_t count, const uint8_t* table);
+static void picture_unpremultiply_span(uint32_t* dst, const uint32_t* src, uint32_t count);
+static void picture_global_alpha_span(uint32_t* dst, uint32_t count, uint8_t alpha);
+static bool pixel_matrix_build(pixel_matrix_t* matrix, const vg_lite_float_t m[20], const bool enable[4], bool* active);
+static void pixel_matrix_span(uint32_t* bits, uint32_t count, const pixel_matrix_t* matrix);
+static Result shape_append_raster(Shape* shape, const path_raster_t* raster, const vg_lite_path_t* path);
+static Result shape_append_rect(vg_lite_ctx* ctx, std::unique_ptr<Shape>& shape, const vg_lite_rectangle_t* rect);
+static Result shape_push_fill(vg_lite_ctx* ctx, const vg_lite_buffer_t* target, vg_lite_path_t* path, vg_lite_fill_t fill_rule,
+    vg_lite_matrix_t* matrix, vg_lite_blend_t blend, std::unique_ptr<Fill> fill);
 static Result canvas_set_target(vg_lite_ctx* ctx, vg_lite_buffer_t* target);
-static Result picture_load(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source, vg_lite_color_t color = 0);
+static bool picture_has_alpha(vg_lite_buffer_format_t format);
+static void picture_line_ops_init(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, picture_line_ops_t* ops);
+static uint32_t* picture_decode(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color);
+static uint64_t picture_hash(const void* data, uint32_t size, uint64_t seed);
+static void picture_gauss_blur(uint32_t* dst, const uint32_t* src, uint32_t width, uint32_t height, const int32_t weights[3]);
+static bool picture_gauss_split(const int32_t weights[3], int32_t taps[2]);
+static void picture_gauss_separable(uint32_t* dst, const uint32_t* src, uint32_t width, uint32_t height, const int32_t taps[2],
+    uint16_t* rows);
+static uint32_t* picture_gaussian(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color);
+static Result picture_load(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source, vg_lite_color_t color = 0,
+    vg_lite_filter_t filter = VG_LITE_FILTER_POINT);
+static Result picture_warp(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* target,
+    const vg_lite_buffer_t* source, const vg_lite_rectangle_t* rect, const vg_lite_matrix_t* matrix,
+    vg_lite_filter_t filter, vg_lite_color_t color, const int32_t area[4] = nullptr,
+    vg_lite_pattern_mode_t mode = VG_LITE_PATTERN_COLOR, uint32_t border = 0);
+static bool picture_quarter_turn(const vg_lite_matrix_t* matrix, uint32_t* quarter, int32_t offset[2]);
+static Result picture_turn(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source,
+    const int32_t area[4], uint32_t quarter, const int32_t offset[2], vg_lite_filter_t filter, vg_lite_color_t color);
 
 static inline bool math_zero(float a)
 {
@@ -305,6 +1062,34 @@ static inline bool math_equal(float a, float b)
     return math_zero(a - b);
 }
 
+/* A path set up by vg_lite_tvg_path_pack_get_path(), uploaded.handle points
+ * to the pack and uploaded.memory to the pack entry.
+ */
+static inline bool path_is_compiled(const vg_lite_path_t* path)
+{
+    return path->path == NULL && path->uploaded.handle != NULL;
+}
+
+static vg_lite_error_t grad_ramp_acquire(vg_lite_ctx* ctx, vg_lite_buffer_t* image, grad_ramp_kind_t kind,
+    uint32_t width, uint32_t fill_width, const vg_lite_color_ramp_t* ramp, uint32_t ramp_length, uint8_t pre_multiplied,
+    vg_lite_gradient_spreadmode_t spread_mode, bool* cached);
+static vg_lite_error_t grad_ramp_release(vg_lite_ctx* ctx, vg_lite_buffer_t* image);
+static vg_lite_error_t grad_ramp_fill(uint32_t* bits, uint32_t width, const vg_lite_color_ramp_t* ramp, uint8_t pre_multiplied);
+static void grad_ramp_color(const vg_lite_color_ramp_t* ramp, uint8_t pre_multiplied, FLOATVECTOR4 color);
+static Fill::ColorStop grad_fill_stop(float offset, const FLOATVECTOR4 color);
+static FillSpread grad_fill_spread(vg_lite_gradient_spreadmode_t spread_mode);
+static void grad_fill_canvas_stops(vg_lite_ctx* ctx, Fill::ColorStop* stops, uint32_t count);
+static Fill* grad_fill_find(vg_lite_ctx* ctx, const void* grad, vg_lite_gradient_spreadmode_t spread_mode, vg_lite_color_t paint_color);
+static Result grad_fill_store(vg_lite_ctx* ctx, const void* grad, std::unique_ptr<Fill> fill, grad_ramp_kind_t kind,
+    const vg_lite_color_ramp_t* ramp, uint32_t ramp_length, uint8_t pre_multiplied,
+    vg_lite_gradient_spreadmode_t spread_mode, vg_lite_color_t paint_color);
+static void grad_fill_insert(vg_lite_ctx* ctx, const void* grad, vg_lite_color_t paint_color, std::unique_ptr<Fill> fill);
+static Result grad_fill_compile(vg_lite_ctx* ctx, const vg_lite_linear_gradient_t* grad, Fill** fill);
+static void grad_fill_release(vg_lite_ctx* ctx, const void* grad);
+static bool grad_fill_matrix(const vg_lite_matrix_t* path_matrix, const vg_lite_matrix_t* grad_matrix, vg_lite_matrix_t* matrix);
+static Result grad_axis_push(vg_lite_ctx* ctx, const vg_lite_ext_linear_gradient_t* grad, vg_lite_path_t* path,
+    vg_lite_fill_t fill_rule, vg_lite_matrix_t* path_matrix, vg_lite_blend_t blend, bool* drawn);
+static void grad_ramp_fill_dda(uint32_t* bits, uint32_t color0, uint32_t color1, int32_t ds);
 static void ClampColor(FLOATVECTOR4 Source, FLOATVECTOR4 Target, uint8_t Premultiplied);
 static uint8_t PackColorComponent(vg_lite_float_t value);
 static void get_format_bytes(vg_lite_buffer_format_t format,
@@ -319,7 +1104,7 @@ static void get_format_bytes(vg_lite_buffer_format_t format,
 /* color converters */
 
 static vg_lite_converter<vg_color16_t, vg_color32_t> conv_bgra8888_to_bgr565(
-    [](vg_color16_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color16_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* /* gamma */) {
         while (px_size--) {
             dest->red = src->red >> 3;
             dest->green = src->green >> 2;
@@ -330,7 +1115,7 @@ static vg_lite_converter<vg_color16_t, vg_color32_t> conv_bgra8888_to_bgr565(
     });
 
 static vg_lite_converter<vg_color16_alpha_t, vg_color32_t> conv_bgra8888_to_bgra5658(
-    [](vg_color16_alpha_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color16_alpha_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* /* gamma */) {
         while (px_size--) {
             dest->c.red = src->red >> 3;
             dest->c.green = src->green >> 2;
@@ -342,7 +1127,19 @@ static vg_lite_converter<vg_color16_alpha_t, vg_color32_t> conv_bgra8888_to_bgra
     });
 
 static vg_lite_converter<vg_color32_t, vg_color16_t> conv_bgr565_to_bgra8888(
-    [](vg_color32_t* dest, const vg_color16_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color32_t* dest, const vg_color16_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* gamma) {
+        if (gamma) {
+            while (px_size--) {
+                dest->red = gamma[src->red << 3];
+                dest->green = gamma[src->green << 2];
+                dest->blue = gamma[src->blue << 3];
+                dest->alpha = 0xFF;
+                src++;
+                dest++;
+            }
+            return;
+        }
+
         while (px_size--) {
             dest->red = src->red << 3;
             dest->green = src->green << 2;
@@ -351,10 +1148,11 @@ static vg_lite_converter<vg_color32_t, vg_color16_t> conv_bgr565_to_bgra8888(
             src++;
             dest++;
         }
-    });
+    },
+    true);
 
 static vg_lite_converter<vg_color32_t, vg_color16_alpha_t> conv_bgra5658_to_bgra8888(
-    [](vg_color32_t* dest, const vg_color16_alpha_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color32_t* dest, const vg_color16_alpha_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* /* gamma */) {
         while (px_size--) {
             dest->red = src->c.red << 3;
             dest->green = src->c.green << 2;
@@ -366,17 +1164,42 @@ static vg_lite_converter<vg_color32_t, vg_color16_alpha_t> conv_bgra5658_to_bgra
     });
 
 static vg_lite_converter<vg_color32_t, vg_color32_t> conv_bgrx8888_to_bgra8888(
-    [](vg_color32_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color32_t* dest, const vg_color32_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* gamma) {
+        if (gamma) {
+            while (px_size--) {
+                dest->red = gamma[src->red];
+                dest->green = gamma[src->green];
+                dest->blue = gamma[src->blue];
+                dest->alpha = 0xFF;
+                dest++;
+                src++;
+            }
+            return;
+        }
+
         while (px_size--) {
             *dest = *src;
             dest->alpha = 0xFF;
             dest++;
             src++;
         }
-    });
+    },
+    true);
 
 static vg_lite_converter<vg_color32_t, vg_color24_t> conv_bgr888_to_bgra8888(
-    [](vg_color32_t* dest, const vg_color24_t* src, uint32_t px_size, uint32_t /* color */) {
+    [](vg_color32_t* dest, const vg_color24_t* src, uint32_t px_size, uint32_t /* color */, const uint8_t* gamma) {
+        if (gamma) {
+            while (px_size--) {
+                dest->red = gamma[src->red];
+                dest->green = gamma[src->green];
+                dest->blue = gamma[src->blue];
+                dest->alpha = 0xFF;
+                src++;
+                dest++;
+            }
+            return;
+        }
+
         while (px_size--) {
             dest->red = src->red;
             dest->green = src->green;
@@ -385,10 +1208,11 @@ static vg_lite_converter<vg_color32_t, vg_color24_t> conv_bgr888_to_bgra8888(
             src++;
             dest++;
         }
-    });
+    },
+    true);
 
 static vg_lite_converter<vg_color32_t, uint8_t> conv_alpha8_to_bgra8888(
-    [](vg_color32_t* dest, const uint8_t* src, uint32_t px_size, uint32_t color) {
+    [](vg_color32_t* dest, const uint8_t* src, uint32_t px_size, uint32_t color, const uint8_t* /* gamma */) {
         while (px_size--) {
             uint8_t alpha = *src;
             dest->alpha = alpha;
@@ -401,7 +1225,7 @@ static vg_lite_converter<vg_color32_t, uint8_t> conv_alpha8_to_bgra8888(
     });
 
 static vg_lite_converter<vg_color32_t, uint8_t> conv_alpha4_to_bgra8888(
-    [](vg_color32_t* dest, const uint8_t* src, uint32_t px_size, uint32_t color) {
+    [](vg_color32_t* dest, const uint8_t* src, uint32_t px_size, uint32_t color, const uint8_t* /* gamma */) {
         /* 1 byte -> 2 px */
         px_size /= 2;
 
@@ -506,10 +1330,12 @@ vg_lite_error_t vg_lite_clear(vg_lite_buffer_t* target, vg_lite_rectangle_t* rec
     auto ctx = vg_lite_ctx::get_instance();
     TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+    color = ctx->get_canvas_color(color);
+
     auto shape = Shape::gen();
-    TVG_CHECK_RETURN_VG_ERROR(shape_append_rect(shape, target, rectangle));
+    TVG_CHECK_RETURN_VG_ERROR(shape_append_rect(ctx, shape, rectangle));
     TVG_CHECK_RETURN_VG_ERROR(shape->fill(TVG_COLOR(color)));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+    TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(shape)));
 
     return VG_LITE_SUCCESS;
 }
@@ -525,11 +1351,37 @@ vg_lite_error_t vg_lite_blit(vg_lite_buffer_t* target,
     canvas_set_target(ctx, target);
 
     auto picture = Picture::gen();
+    auto matrix_type = vg_lite_tvg_matrix_classify(matrix);
+    bool clip = true;
+
+    if (matrix_type == VG_LITE_TVG_MATRIX_PERSPECTIVE) {
+        TVG_CHECK_RETURN_VG_ERROR(picture_warp(ctx, picture, target, source, nullptr, matrix, filter, color));
+        if (!picture) {
+            ctx->stats.draw_culled++;
+            return VG_LITE_SUCCESS;
+        }
+    } else {
+        float rect[4] = { 0, 0, (float)source->width, (float)source->height };
+        int32_t bounds[4];
+        device_bounds(matrix, matrix_type, rect, bounds);
+        if (!draw_visible(ctx, bounds, &clip)) {
+            return VG_LITE_SUCCESS;
+        }
+
+        uint32_t quarter;
+        int32_t offset[2];
+        if (matrix_type == VG_LITE_TVG_MATRIX_AFFINE && picture_quarter_turn(matrix, &quarter, offset)) {
+            const int32_t area[4] = { 0, 0, (int32_t)source->width, (int32_t)source->height };
+            TVG_CHECK_RETURN_VG_ERROR(picture_turn(ctx, picture, source, area, quarter, offset, filter, color));
+        } else {
+            TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color, filter));
+            TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(matrix)));
+        }
+    }
 
-    TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color));
-    TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(matrix)));
     TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+    TVG_CHECK_RETURN_VG_ERROR(picture->opacity(ctx->get_source_opacity()));
+    TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(picture), clip));
 
     return VG_LITE_SUCCESS;
 }
@@ -565,16 +1417,61 @@ vg_lite_error_t vg_lite_blit_rect(vg_lite_buffer_t* target,
     auto ctx = vg_lite_ctx::get_instance();
     TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+    auto matrix_type = vg_lite_tvg_matrix_classify(matrix);
+
+    if (matrix_type == VG_LITE_TVG_MATRIX_PERSPECTIVE) {
+        /* the sampler clips to (rect) itself */
+        auto picture = Picture::gen();
+        TVG_CHECK_RETURN_VG_ERROR(picture_warp(ctx, picture, target, source, rect, matrix, filter, color));
+        if (!picture) {
+            ctx->stats.draw_culled++;
+            return VG_LITE_SUCCESS;
+        }
+        TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
+        TVG_CHECK_RETURN_VG_ERROR(picture->opacity(ctx->get_source_opacity()));
+        TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(picture)));
+        return VG_LITE_SUCCESS;
+    }
+
+    float area[4] = { 0, 0, (float)source->width, (float)source->height };
+    if (rect) {
+        area[0] = MAX(area[0], (float)rect->x);
+        area[1] = MAX(area[1], (float)rect->y);
+        area[2] = MIN(area[2], (float)(rect->x + rect->width));
+        area[3] = MIN(area[3], (float)(rect->y + rect->height));
+    }
+
+    int32_t bounds[4];
+    bool clip = true;
+    device_bounds(matrix, matrix_type, area, bounds);
+    if (area[0] >= area[2] || area[1] >= area[3] || !draw_visible(ctx, bounds, &clip)) {
+        return VG_LITE_SUCCESS;
+    }
+
+    /* a turned rectangle needs no clip shape, only its pixels are loaded */
+    uint32_t quarter;
+    int32_t offset[2];
+    if (matrix_type == VG_LITE_TVG_MATRIX_AFFINE && picture_quarter_turn(matrix, &quarter, offset)) {
+        const int32_t pixels[4] = { (int32_t)area[0], (int32_t)area[1], (int32_t)area[2], (int32_t)area[3] };
+        auto picture = tvg::Picture::gen();
+        TVG_CHECK_RETURN_VG_ERROR(picture_turn(ctx, picture, source, pixels, quarter, offset, filter, color));
+        TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
+        TVG_CHECK_RETURN_VG_ERROR(picture->opacity(ctx->get_source_opacity()));
+        TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(picture), clip));
+        return VG_LITE_SUCCESS;
+    }
+
     auto shape = Shape::gen();
-    TVG_CHECK_RETURN_VG_ERROR(shape_append_rect(shape, target, rect));
+    TVG_CHECK_RETURN_VG_ERROR(shape_append_rect(ctx, shape, rect));
     TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
 
     auto picture = tvg::Picture::gen();
-    TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color));
+    TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, source, color, filter));
     TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(matrix)));
     TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
+    TVG_CHECK_RETURN_VG_ERROR(picture->opacity(ctx->get_source_opacity()));
     TVG_CHECK_RETURN_VG_ERROR(picture->composite(std::move(shape), CompositeMethod::ClipPath));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+    TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(picture), clip));
 
     return VG_LITE_SUCCESS;
 }
@@ -600,26 +1497,470 @@ vg_lite_error_t vg_lite_close(void)
     return VG_LITE_SUCCESS;
 }
 
-static void picture_bgra8888_to_bgr565(vg_color16_t* dest, const vg_color32_t* src, uint32_t px_size)
+/* Offsets added to B, G and R before truncating to 565, four pixels of row (y)
+ * of a 4x4 Bayer matrix from column (x) on. Zero without (dither).
+ */
+static void picture_dither_row(uint32_t row[4], uint32_t x, uint32_t y, bool dither)
 {
-    while (px_size--) {
-        dest->red = src->red >> 3;
-        dest->green = src->green >> 2;
-        dest->blue = src->blue >> 3;
-        src++;
-        dest++;
+    static const uint8_t bayer[4][4] = {
+        { 0, 8, 2, 10 },
+        { 12, 4, 14, 6 },
+        { 3, 11, 1, 9 },
+        { 15, 7, 13, 5 },
+    };
+
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t d = dither ? bayer[y & 3][(x + i) & 3] : 0;
+        row[i] = ((d >> 1) << 16) | ((d >> 2) << 8) | (d >> 1);
+    }
+}
+
+/* B, G and R of (c) plus the dither offsets (d), saturated at 255. */
+static inline uint32_t picture_dither_add(uint32_t c, uint32_t d)
+{
+    uint32_t r = MIN(R(c) + R(d), 255U);
+    uint32_t g = MIN(G(c) + G(d), 255U);
+    uint32_t b = MIN(B(c) + B(d), 255U);
+    return (c & 0xFF000000) | (r << 16) | (g << 8) | b;
+}
+
+static inline uint16_t picture_pack_565(uint32_t c)
+{
+    return (uint16_t)(((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F));
+}
+
+/* R, G and B of the 565 color (c) as the source converters expand them. */
+static inline uint32_t picture_unpack_565(uint32_t c)
+{
+    return ((c & 0xF800) << 8) | ((c & 0x07E0) << 5) | ((c & 0x001F) << 3);
+}
+
+/* Pixel (i, j) of a source (width) x (height) image turned by (quarter) clockwise
+ * quarter turns, 1 or 3. Column (j) of the source becomes row (j) of the result.
+ */
+static inline uint32_t picture_rotate_pixel(const uint32_t* src, uint32_t stride, uint32_t width, uint32_t height,
+    uint32_t quarter, uint32_t i, uint32_t j)
+{
+    uint32_t x = quarter == 1 ? j : width - 1 - j;
+    uint32_t y = quarter == 1 ? height - 1 - i : i;
+    return src[y * stride + x];
+}
+
+/* Turn (src) by (quarter) clockwise quarter turns into (dst), which is (height)
+ * pixels wide for odd turns and (width) wide otherwise. Quarter turns read the
+ * source by columns, so they go tile by tile.
+ */
+static void picture_rotate(uint32_t* dst, const uint32_t* src, uint32_t stride, uint32_t width, uint32_t height, uint32_t quarter)
+{
+    if (quarter == 2) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint32_t* in = src + (height - 1 - y) * stride;
+            uint32_t x = 0;
+
+#if defined(__SSE2__)
+            for (; x + 4 <= width; x += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(in + width - 4 - x));
+                _mm_storeu_si128((__m128i*)(dst + x), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+            }
+#endif
+
+            for (; x < width; x++) {
+                dst[x] = in[width - 1 - x];
+            }
+            dst += width;
+        }
+        return;
+    }
+
+    /* (dst) is (height) wide and (width) tall */
+    for (uint32_t tj = 0; tj < width; tj += PICTURE_ROTATE_TILE) {
+        uint32_t j_end = MIN(tj + PICTURE_ROTATE_TILE, width);
+        for (uint32_t ti = 0; ti < height; ti += PICTURE_ROTATE_TILE) {
+            uint32_t i_end = MIN(ti + PICTURE_ROTATE_TILE, height);
+            uint32_t j = tj;
+
+#if defined(__SSE2__)
+            /* 4x4 blocks: four source rows transposed into four result rows */
+            for (; j + 4 <= j_end; j += 4) {
+                uint32_t i = ti;
+                for (; i + 4 <= i_end; i += 4) {
+                    __m128i v[4];
+                    for (int k = 0; k < 4; k++) {
+                        uint32_t y = quarter == 1 ? height - 1 - (i + k) : i + k;
+                        uint32_t x = quarter == 1 ? j : width - 4 - j;
+                        v[k] = _mm_loadu_si128((const __m128i*)(src + y * stride + x));
+                    }
+
+                    __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]);
+                    __m128i t1 = _mm_unpacklo_epi32(v[2], v[3]);
+                    __m128i t2 = _mm_unpackhi_epi32(v[0], v[1]);
+                    __m128i t3 = _mm_unpackhi_epi32(v[2], v[3]);
+                    __m128i r[4] = {
+                        _mm_unpacklo_epi64(t0, t1),
+                        _mm_unpackhi_epi64(t0, t1),
+                        _mm_unpacklo_epi64(t2, t3),
+                        _mm_unpackhi_epi64(t2, t3),
+                    };
+
+                    /* three quarter turns read the columns right to left */
+                    for (int m = 0; m < 4; m++) {
+                        _mm_storeu_si128((__m128i*)(dst + (j + m) * height + i), r[quarter == 1 ? m : 3 - m]);
+                    }
+                }
+
+                for (; i < i_end; i++) {
+                    for (uint32_t m = 0; m < 4; m++) {
+                        dst[(j + m) * height + i] = picture_rotate_pixel(src, stride, width, height, quarter, i, j + m);
+                    }
+                }
+            }
+#endif
+
+            for (; j < j_end; j++) {
+                for (uint32_t i = ti; i < i_end; i++) {
+                    dst[j * height + i] = picture_rotate_pixel(src, stride, width, height, quarter, i, j);
+                }
+            }
+        }
+    }
+}
+
+static const uint32_t* picture_resolve_band(picture_resolve_t* resolve, uint32_t row);
+
+/* Canvas pixels x0 to x1 of target row (y). Rows of a rotated canvas are
+ * turned a band at a time, linear light and straight alpha converted a row at
+ * a time, so the resolve reads them while they are in the cache.
+ */
+static const uint32_t* picture_resolve_row(picture_resolve_t* resolve, uint32_t y)
+{
+    uint32_t width = resolve->width;
+    uint32_t count = resolve->x1 - resolve->x0;
+    uint32_t row = resolve->mirror ? resolve->height - 1 - y : y;
+
+    const uint32_t* pixels;
+    if (!resolve->quarter) {
+        pixels = resolve->src + row * width + resolve->x0;
+    } else {
+        pixels = picture_resolve_band(resolve, row);
+    }
+
+    if (!resolve->gamma && !resolve->straight) {
+        return pixels;
+    }
+
+    if (resolve->gamma) {
+        picture_gamma_span(resolve->line, pixels, count, resolve->gamma);
+        pixels = resolve->line;
+    }
+
+    if (resolve->straight) {
+        picture_unpremultiply_span(resolve->line, pixels, count);
+    }
+    return resolve->line;
+}
+
+/* Canvas pixels x0 to x1 of target row (row) of a rotated canvas. Target (x, row)
+ * is canvas (row, w - 1 - x), (w - 1 - x, h - 1 - row) or (h - 1 - row, x) for
+ * one, two or three turns, with the target w x h.
+ */
+static const uint32_t* picture_resolve_band(picture_resolve_t* resolve, uint32_t row)
+{
+    uint32_t width = resolve->width;
+    uint32_t height = resolve->height;
+    uint32_t x0 = resolve->x0;
+    uint32_t count = resolve->x1 - x0;
+
+    if (!resolve->band_rows || row < resolve->band_y || row >= resolve->band_y + resolve->band_rows) {
+        uint32_t y0 = row - row % PICTURE_RESOLVE_BAND;
+        uint32_t rows = MIN(PICTURE_RESOLVE_BAND, height - y0);
+
+        /* the target rows of a band are canvas columns for odd turns, rows otherwise */
+        switch (resolve->quarter) {
+        case 1:
+            picture_rotate(resolve->band, resolve->src + (width - x0 - count) * height + y0, height, rows, count, 1);
+            break;
+        case 2:
+            picture_rotate(resolve->band, resolve->src + (height - y0 - rows) * width + (width - x0 - count), width, count, rows, 2);
+            break;
+        default:
+            picture_rotate(resolve->band, resolve->src + x0 * height + (height - y0 - rows), height, rows, count, 3);
+            break;
+        }
+
+        resolve->band_y = y0;
+        resolve->band_rows = rows;
+    }
+
+    return resolve->band + (row - resolve->band_y) * count;
+}
+
+static void picture_bgra8888_to_bgr565(vg_color16_t* dest, picture_resolve_t* resolve, bool dither)
+{
+    uint32_t width = resolve->x1 - resolve->x0;
+
+    for (uint32_t y = resolve->y0; y < resolve->y1; y++) {
+        const uint32_t* in = picture_resolve_row(resolve, y);
+        uint16_t* out = (uint16_t*)((uint8_t*)dest + y * resolve->stride) + resolve->x0;
+        uint32_t row[4];
+        uint32_t x = 0;
+        picture_dither_row(row, resolve->x0, y, dither);
+
+#if defined(__SSE2__)
+        /* one dither vector covers four pixels, (row) starts at x0 */
+        const __m128i d = _mm_loadu_si128((const __m128i*)row);
+        const __m128i r_mask = _mm_set1_epi32(0xF800);
+        const __m128i g_mask = _mm_set1_epi32(0x07E0);
+        const __m128i b_mask = _mm_set1_epi32(0x001F);
+        for (; x + 8 <= width; x += 8) {
+            __m128i c[2];
+            for (int i = 0; i < 2; i++) {
+                __m128i p = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + x + i * 4)), d);
+                __m128i v = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 8), r_mask),
+                    _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 5), g_mask), _mm_and_si128(_mm_srli_epi32(p, 3), b_mask)));
+                /* sign extend, so packs keeps all 16 bits */
+                c[i] = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+            }
+            _mm_storeu_si128((__m128i*)(out + x), _mm_packs_epi32(c[0], c[1]));
+        }
+#endif
+
+        for (; x < width; x++) {
+            out[x] = picture_pack_565(picture_dither_add(in[x], row[x & 3]));
+        }
+    }
+}
+
+static void picture_bgra8888_to_bgra5658(vg_color16_alpha_t* dest, picture_resolve_t* resolve,
+    bool dither, vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+{
+    uint32_t width = resolve->x1 - resolve->x0;
+
+    /* UDIV255(a * 255) is a */
+    const bool global = alpha_mode == VG_LITE_GLOBAL;
+    const uint32_t scale = alpha_mode == VG_LITE_SCALED ? alpha_value : 255;
+
+    for (uint32_t y = resolve->y0; y < resolve->y1; y++) {
+        const uint32_t* in = picture_resolve_row(resolve, y);
+        uint8_t* out = (uint8_t*)dest + y * resolve->stride + resolve->x0 * sizeof(vg_color16_alpha_t);
+        uint32_t row[4];
+        uint32_t x = 0;
+        picture_dither_row(row, resolve->x0, y, dither);
+
+#if defined(__SSE2__)
+        const __m128i d = _mm_loadu_si128((const __m128i*)row);
+        const __m128i r_mask = _mm_set1_epi32(0xF800);
+        const __m128i g_mask = _mm_set1_epi32(0x07E0);
+        const __m128i b_mask = _mm_set1_epi32(0x001F);
+        const __m128i alpha_scale = _mm_set1_epi32((int)scale);
+        const __m128i alpha_global = _mm_set1_epi32(alpha_value);
+        const __m128i div = _mm_set1_epi32(0x8081);
+        for (; x + 4 <= width; x += 4) {
+            __m128i c = _mm_loadu_si128((const __m128i*)(in + x));
+            __m128i p = _mm_adds_epu8(c, d);
+            __m128i v = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 8), r_mask),
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 5), g_mask), _mm_and_si128(_mm_srli_epi32(p, 3), b_mask)));
+            __m128i a = alpha_global;
+            if (!global) {
+                /* a * scale fits the low 16 bits of each lane */
+                a = _mm_mullo_epi16(_mm_srli_epi32(c, 24), alpha_scale);
+                a = _mm_srli_epi32(_mm_mulhi_epu16(a, div), 7);
+            }
+
+            /* four 24-bit pixels in three words */
+            uint32_t px[4];
+            _mm_storeu_si128((__m128i*)px, _mm_or_si128(v, _mm_slli_epi32(a, 16)));
+            uint32_t words[3] = {
+                px[0] | (px[1] << 24),
+                (px[1] >> 8) | (px[2] << 16),
+                (px[2] >> 16) | (px[3] << 8),
+            };
+            memcpy(out, words, sizeof(words));
+            out += sizeof(words);
+        }
+#endif
+
+        for (; x < width; x++) {
+            uint32_t c = in[x];
+            uint16_t color = picture_pack_565(picture_dither_add(c, row[x & 3]));
+            out[0] = (uint8_t)color;
+            out[1] = (uint8_t)(color >> 8);
+            out[2] = global ? alpha_value : (uint8_t)UDIV255(A(c) * scale);
+            out += sizeof(vg_color16_alpha_t);
+        }
     }
 }
 
-static void picture_bgra8888_to_bgra5658(vg_color16_alpha_t* dest, const vg_color32_t* src, uint32_t px_size)
+static void picture_global_alpha(uint32_t* buffer, uint32_t px_size,
+    vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
 {
+    if (alpha_mode == VG_LITE_GLOBAL) {
+        const uint32_t alpha = (uint32_t)alpha_value << 24;
+        while (px_size--) {
+            *buffer = (*buffer & 0x00FFFFFF) | alpha;
+            buffer++;
+        }
+        return;
+    }
+
     while (px_size--) {
-        dest->c.red = src->red >> 3;
-        dest->c.green = src->green >> 2;
-        dest->c.blue = src->blue >> 3;
-        dest->alpha = src->alpha;
-        src++;
-        dest++;
+        *buffer = (*buffer & 0x00FFFFFF) | (UDIV255(A(*buffer) * alpha_value) << 24);
+        buffer++;
+    }
+}
+
+/* Canvas rows copied to the target, the destination alpha is applied to each
+ * row while it is still in the cache.
+ */
+static void picture_bgra8888_copy(uint32_t* dest, picture_resolve_t* resolve,
+    vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+{
+    uint32_t width = resolve->x1 - resolve->x0;
+
+    for (uint32_t y = resolve->y0; y < resolve->y1; y++) {
+        uint32_t* out = (uint32_t*)((uint8_t*)dest + y * resolve->stride) + resolve->x0;
+        memcpy(out, picture_resolve_row(resolve, y), width * sizeof(uint32_t));
+        if (alpha_mode != VG_LITE_NORMAL) {
+            picture_global_alpha(out, width, alpha_mode, alpha_value);
+        }
+    }
+}
+
+/* The resolve of the temporary buffer into target_buffer, limited to the target
+ * pixels under the canvas pixels drawn since the last vg_lite_finish().
+ */
+static void picture_resolve_init(vg_lite_ctx* ctx, picture_resolve_t* resolve)
+{
+    uint32_t width = ctx->target_width;
+    uint32_t height = ctx->target_px_size / ctx->target_width;
+
+    resolve->src = ctx->get_temp_target_buffer();
+    resolve->width = width;
+    resolve->height = height;
+    resolve->mirror = ctx->orientation == VG_LITE_ORIENTATION_BOTTOM_TOP;
+    resolve->quarter = ctx->rotation;
+    resolve->stride = ctx->target_buffer_stride;
+    resolve->band = ctx->get_resolve_band(width);
+    resolve->band_y = 0;
+    resolve->band_rows = 0;
+    resolve->gamma = ctx->get_resolve_gamma();
+    resolve->straight = !ctx->dst_premultiplied
+        && (ctx->target_format == VG_LITE_BGRA8888 || ctx->target_format == VG_LITE_BGRA5658);
+    resolve->line = resolve->band + width * PICTURE_RESOLVE_BAND;
+
+    const int32_t* drawn = ctx->drawn;
+    if (drawn[0] >= drawn[2] || drawn[1] >= drawn[3]) {
+        resolve->x0 = resolve->x1 = resolve->y0 = resolve->y1 = 0;
+        return;
+    }
+
+    /* the drawn canvas box turned into target columns and rows, see picture_resolve_band() */
+    uint32_t row0, row1;
+    switch (resolve->quarter) {
+    case 1:
+        resolve->x0 = width - drawn[3];
+        resolve->x1 = width - drawn[1];
+        row0 = drawn[0];
+        row1 = drawn[2];
+        break;
+    case 2:
+        resolve->x0 = width - drawn[2];
+        resolve->x1 = width - drawn[0];
+        row0 = height - drawn[3];
+        row1 = height - drawn[1];
+        break;
+    case 3:
+        resolve->x0 = drawn[1];
+        resolve->x1 = drawn[3];
+        row0 = height - drawn[2];
+        row1 = height - drawn[0];
+        break;
+    default:
+        resolve->x0 = drawn[0];
+        resolve->x1 = drawn[2];
+        row0 = drawn[1];
+        row1 = drawn[3];
+        break;
+    }
+
+    resolve->y0 = resolve->mirror ? height - row1 : row0;
+    resolve->y1 = resolve->mirror ? height - row0 : row1;
+}
+
+/* Load the target pixels (resolve) writes back into (canvas), premultiplied and
+ * through (gamma), so paints blend over them and the pixels they leave are
+ * written back unchanged.
+ */
+static void picture_resolve_load(uint32_t* canvas, const void* target, vg_lite_buffer_format_t format,
+    picture_resolve_t* resolve, const uint8_t* gamma)
+{
+    uint32_t width = resolve->width;
+    uint32_t height = resolve->height;
+    uint32_t x0 = resolve->x0;
+    uint32_t count = resolve->x1 - x0;
+    uint32_t* line = resolve->line;
+
+    for (uint32_t y = resolve->y0; y < resolve->y1; y++) {
+        const uint8_t* in = (const uint8_t*)target + y * resolve->stride;
+
+        switch (format) {
+        case VG_LITE_BGR565:
+            for (uint32_t i = 0; i < count; i++) {
+                line[i] = 0xFF000000 | picture_unpack_565(((const uint16_t*)in)[x0 + i]);
+            }
+            break;
+        case VG_LITE_BGRA5658:
+            for (uint32_t i = 0; i < count; i++) {
+                const uint8_t* px = in + (x0 + i) * sizeof(vg_color16_alpha_t);
+                uint32_t c = (uint32_t)px[2] << 24 | picture_unpack_565(px[0] | (px[1] << 8));
+                if (!resolve->straight) {
+                    /* the dither may have rounded a color above its alpha */
+                    uint32_t a = A(c);
+                    uint32_t r = MIN(R(c), a);
+                    uint32_t g = MIN(G(c), a);
+                    uint32_t b = MIN(B(c), a);
+                    c = (a << 24) | (r << 16) | (g << 8) | b;
+                }
+                line[i] = c;
+            }
+            break;
+        case VG_LITE_BGRX8888:
+            for (uint32_t i = 0; i < count; i++) {
+                line[i] = 0xFF000000 | ((const uint32_t*)in)[x0 + i];
+            }
+            break;
+        default:
+            memcpy(line, (const uint32_t*)in + x0, count * sizeof(uint32_t));
+            break;
+        }
+
+        if (resolve->straight) {
+            picture_premultiply_span(line, line, count, gamma);
+        } else if (gamma) {
+            picture_gamma_span(line, line, count, gamma);
+        }
+
+        /* the inverse of picture_resolve_row() */
+        uint32_t row = resolve->mirror ? height - 1 - y : y;
+        switch (resolve->quarter) {
+        case 1:
+            for (uint32_t i = 0; i < count; i++) {
+                canvas[(width - 1 - x0 - i) * height + row] = line[i];
+            }
+            break;
+        case 2:
+            for (uint32_t i = 0; i < count; i++) {
+                canvas[(height - 1 - row) * width + width - 1 - x0 - i] = line[i];
+            }
+            break;
+        case 3:
+            for (uint32_t i = 0; i < count; i++) {
+                canvas[(x0 + i) * height + height - 1 - row] = line[i];
+            }
+            break;
+        default:
+            memcpy(canvas + row * width + x0, line, count * sizeof(uint32_t));
+            break;
+        }
     }
 }
 
@@ -627,27 +1968,52 @@ vg_lite_error_t vg_lite_finish(void)
 {
     vg_lite_ctx* ctx = vg_lite_ctx::get_instance();
 
+    TVG_CHECK_RETURN_VG_ERROR(ctx->batch_end());
+
+    /* Targets ThorVG can't draw in place are drawn in the temporary buffer,
+     * loaded from the target where the paints go and resolved back from there.
+     */
+    picture_resolve_t resolve;
+    if (ctx->target_buffer) {
+        picture_resolve_init(ctx, &resolve);
+        picture_resolve_load(ctx->get_temp_target_buffer(), ctx->target_buffer, ctx->target_format, &resolve,
+            ctx->get_canvas_gamma());
+    }
+
+    /* nothing was pushed since the last call */
     if (ctx->canvas->draw() == Result::InsufficientCondition) {
+        ctx->drawn[0] = ctx->drawn[2] = 0;
         return VG_LITE_SUCCESS;
     }
 
     TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->sync());
     TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->clear(true));
+    ctx->release_canvas_images();
 
-    /* If target_buffer is not in a format supported by thorvg, software conversion is required. */
     if (ctx->target_buffer) {
         switch (ctx->target_format) {
         case VG_LITE_BGR565:
             picture_bgra8888_to_bgr565(
                 (vg_color16_t*)ctx->target_buffer,
-                (const vg_color32_t*)ctx->get_temp_target_buffer(),
-                ctx->target_px_size);
+                &resolve,
+                ctx->dither_enabled);
             break;
         case VG_LITE_BGRA5658:
             picture_bgra8888_to_bgra5658(
                 (vg_color16_alpha_t*)ctx->target_buffer,
-                (const vg_color32_t*)ctx->get_temp_target_buffer(),
-                ctx->target_px_size);
+                &resolve,
+                ctx->dither_enabled,
+                ctx->dst_alpha_mode,
+                ctx->dst_alpha_value);
+            break;
+        case VG_LITE_BGRA8888:
+        case VG_LITE_BGRX8888:
+            /* formats drawn in place, resolved only when mirrored, rotated or blended linearly */
+            picture_bgra8888_copy(
+                (uint32_t*)ctx->target_buffer,
+                &resolve,
+                ctx->target_format == VG_LITE_BGRA8888 ? ctx->dst_alpha_mode : VG_LITE_NORMAL,
+                ctx->dst_alpha_value);
             break;
         default:
             TVG_LOG("unsupport format: %d\n", ctx->target_format);
@@ -658,8 +2024,18 @@ vg_lite_error_t vg_lite_finish(void)
         /* finish convert, clean target buffer info */
         ctx->target_buffer = nullptr;
         ctx->target_px_size = 0;
+    } else if (ctx->direct_buffer && ctx->target_format == VG_LITE_BGRA8888
+        && ctx->dst_alpha_mode != VG_LITE_NORMAL) {
+        /* the only in-place pass, other formats take it in the conversion above */
+        const int32_t* drawn = ctx->drawn;
+        for (int32_t y = drawn[1]; drawn[0] < drawn[2] && y < drawn[3]; y++) {
+            picture_global_alpha(ctx->direct_buffer + y * ctx->target_stride + drawn[0], drawn[2] - drawn[0],
+                ctx->dst_alpha_mode, ctx->dst_alpha_value);
+        }
     }
 
+    ctx->direct_buffer = nullptr;
+    ctx->drawn[0] = ctx->drawn[2] = 0;
     return VG_LITE_SUCCESS;
 }
 
@@ -678,13 +2054,45 @@ vg_lite_error_t vg_lite_draw(vg_lite_buffer_t* target,
     auto ctx = vg_lite_ctx::get_instance();
     TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+    /* batched paints compare the transformed color */
+    color = ctx->get_paint_color(color);
+
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, matrix);
+
+    int32_t bounds[4];
+    bool bounded = path_raster_device_bounds(raster, bounds);
+    bool clip = true;
+
+    if (bounded && !draw_visible(ctx, bounds, &clip)) {
+        return VG_LITE_SUCCESS;
+    }
+
+    /* a path clipped to its bounding box or the scissor needs a shape of its own */
+    bool batchable = bounded && !clip && !path_raster_need_clip(raster, path);
+
+    if (batchable && ctx->batch_merge(target, fill_rule, matrix, blend, color, bounds)) {
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_raster(ctx->batch_shape(), raster, path));
+        ctx->stats.draw_merged++;
+        return VG_LITE_SUCCESS;
+    }
+
     auto shape = Shape::gen();
-    TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix));
-    TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
+    TVG_CHECK_RETURN_VG_ERROR(shape_append_raster(shape.get(), raster, path));
+
+    /* baked paths are already in device space */
+    if (raster->matrix_type != VG_LITE_TVG_MATRIX_IDENTITY) {
+        TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
+    }
     TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
     TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
     TVG_CHECK_RETURN_VG_ERROR(shape->fill(TVG_COLOR(color)));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+
+    if (batchable) {
+        TVG_CHECK_RETURN_VG_ERROR(ctx->batch_begin(std::move(shape), target, fill_rule, matrix, blend, color, bounds));
+    } else {
+        TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(shape), clip));
+    }
 
     return VG_LITE_SUCCESS;
 }
@@ -724,6 +2132,15 @@ uint32_t vg_lite_query_feature(vg_lite_feature_t feature)
     case gcFEATURE_BIT_VG_24BIT:
     case gcFEATURE_BIT_VG_DITHER:
     case gcFEATURE_BIT_VG_USE_DST:
+    case gcFEATURE_BIT_VG_RADIAL_GRADIENT:
+    case gcFEATURE_BIT_VG_LINEAR_GRADIENT_EXT:
+    case gcFEATURE_BIT_VG_MASK:
+    case gcFEATURE_BIT_VG_GAUSSIAN_BLUR:
+    case gcFEATURE_BIT_VG_COLOR_TRANSFORMATION:
+    case gcFEATURE_BIT_VG_MIRROR:
+    case gcFEATURE_BIT_VG_GAMMA:
+    case gcFEATURE_BIT_VG_HW_PREMULTIPLY:
+    case gcFEATURE_BIT_VG_IM_REPEAT_REFLECT:
 
 #ifdef CONFIG_VG_LITE_TVG_LVGL_BLEND_SUPPORT
     case gcFEATURE_BIT_VG_LVGL_SUPPORT:
@@ -836,20 +2253,57 @@ vg_lite_error_t vg_lite_draw_pattern(vg_lite_buffer_t* target,
     vg_lite_color_t color,
     vg_lite_filter_t filter)
 {
+    if (pattern_mode < VG_LITE_PATTERN_COLOR || pattern_mode > VG_LITE_PATTERN_REFLECT) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    if (pattern_mode != VG_LITE_PATTERN_COLOR && !vg_lite_query_feature(gcFEATURE_BIT_VG_IM_REPEAT_REFLECT)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
     auto ctx = vg_lite_ctx::get_instance();
     TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, path_matrix);
+
+    int32_t bounds[4] = { 0, 0, (int32_t)ctx->canvas_width, (int32_t)ctx->canvas_height };
+    bool clip = true;
+    if (path_raster_device_bounds(raster, bounds) && !draw_visible(ctx, bounds, &clip)) {
+        return VG_LITE_SUCCESS;
+    }
+
     auto shape = Shape::gen();
-    TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, path_matrix));
+    TVG_CHECK_RETURN_VG_ERROR(shape_append_raster(shape.get(), raster, path));
     TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)));
     TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(path_matrix)));
 
+    /* pattern_color is painted like a path color, premultiplied around the image */
+    pattern_color = ctx->get_paint_color(pattern_color);
+    uint32_t a = pattern_color >> 24;
+    uint32_t border = (a << 24) | (UDIV255((pattern_color & 0xFF) * a) << 16)
+        | (UDIV255(((pattern_color >> 8) & 0xFF) * a) << 8) | UDIV255(((pattern_color >> 16) & 0xFF) * a);
+
     auto picture = tvg::Picture::gen();
-    TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, pattern_image, color));
-    TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(pattern_matrix)));
+    if (pattern_mode == VG_LITE_PATTERN_COLOR && !border
+        && vg_lite_tvg_matrix_classify(pattern_matrix) != VG_LITE_TVG_MATRIX_PERSPECTIVE) {
+        /* ThorVG leaves the pixels around the image transparent */
+        TVG_CHECK_RETURN_VG_ERROR(picture_load(ctx, picture, pattern_image, color, filter));
+        TVG_CHECK_RETURN_VG_ERROR(picture->transform(matrix_conv(pattern_matrix)));
+    } else {
+        /* tiled by the sampler over the path bounds, a single picture for the whole path */
+        TVG_CHECK_RETURN_VG_ERROR(picture_warp(ctx, picture, target, pattern_image, nullptr, pattern_matrix, filter, color,
+            bounds, pattern_mode, border));
+        if (!picture) {
+            ctx->stats.draw_culled++;
+            return VG_LITE_SUCCESS;
+        }
+    }
+
     TVG_CHECK_RETURN_VG_ERROR(picture->blend(blend_method_conv(blend)));
+    TVG_CHECK_RETURN_VG_ERROR(picture->opacity(ctx->get_source_opacity()));
     TVG_CHECK_RETURN_VG_ERROR(picture->composite(std::move(shape), CompositeMethod::ClipPath));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(picture)));
+    TVG_CHECK_RETURN_VG_ERROR(ctx->push(std::move(picture), clip));
 
     return VG_LITE_SUCCESS;
 }
@@ -1008,9 +2462,8 @@ vg_lite_error_t vg_lite_update_linear_grad(vg_lite_ext_linear_gradient_t* grad)
 {
     uint32_t ramp_length;
     vg_lite_color_ramp_t* color_ramp;
-    uint32_t common, stop;
+    uint32_t common;
     uint32_t i, width;
-    uint8_t* bits;
     vg_lite_float_t x0, y0, x1, y1, length;
     vg_lite_error_t error = VG_LITE_SUCCESS;
 
@@ -1051,99 +2504,19 @@ vg_lite_error_t vg_lite_update_linear_grad(vg_lite_ext_linear_gradient_t* grad)
     /* Compute the width of the required color array. */
     width = common + 1;
 
-    /* Allocate the color ramp surface. */
-    memset(&grad->image, 0, sizeof(grad->image));
-    grad->image.width = width;
-    grad->image.height = 1;
-    grad->image.stride = 0;
-    grad->image.image_mode = VG_LITE_NONE_IMAGE_MODE;
-    grad->image.format = VG_LITE_ABGR8888;
-
-    /* Allocate the image for gradient. */
-    VG_LITE_RETURN_ERROR(vg_lite_allocate(&grad->image));
-    memset(grad->image.memory, 0, grad->image.stride * grad->image.height);
-    width = common + 1;
-    /* Set pointer to color array. */
-    bits = (uint8_t*)grad->image.memory;
-
-    /* Start filling the color array. */
-    stop = 0;
-    for (i = 0; i < width; ++i) {
-        vg_lite_float_t gradient;
-        vg_lite_float_t color[4];
-        vg_lite_float_t color1[4];
-        vg_lite_float_t color2[4];
-        vg_lite_float_t weight;
-
-        if (i == 241)
-            i = 241;
-        /* Compute gradient for current color array entry. */
-        gradient = (vg_lite_float_t)i / (vg_lite_float_t)(width - 1);
-
-        /* Find the entry in the color ramp that matches or exceeds this
-        ** gradient. */
-        while (gradient > color_ramp[stop].stop) {
-            ++stop;
-        }
-
-        if (gradient == color_ramp[stop].stop) {
-            /* Perfect match weight 1.0. */
-            weight = 1.0f;
-
-            /* Use color ramp color. */
-            color1[3] = color_ramp[stop].alpha;
-            color1[2] = color_ramp[stop].blue;
-            color1[1] = color_ramp[stop].green;
-            color1[0] = color_ramp[stop].red;
-
-            color2[3] = color2[2] = color2[1] = color2[0] = 0.0f;
-        } else {
-            if (stop == 0) {
-                return VG_LITE_INVALID_ARGUMENT;
-            }
-            /* Compute weight. */
-            weight = (color_ramp[stop].stop - gradient)
-                / (color_ramp[stop].stop - color_ramp[stop - 1].stop);
-
-            /* Grab color ramp color of previous stop. */
-            color1[3] = color_ramp[stop - 1].alpha;
-            color1[2] = color_ramp[stop - 1].blue;
-            color1[1] = color_ramp[stop - 1].green;
-            color1[0] = color_ramp[stop - 1].red;
-
-            /* Grab color ramp color of current stop. */
-            color2[3] = color_ramp[stop].alpha;
-            color2[2] = color_ramp[stop].blue;
-            color2[1] = color_ramp[stop].green;
-            color2[0] = color_ramp[stop].red;
-        }
-
-        if (grad->pre_multiplied) {
-            /* Pre-multiply the first color. */
-            color1[2] *= color1[3];
-            color1[1] *= color1[3];
-            color1[0] *= color1[3];
+    /* The color stops of the drawing fill are rebuilt on the next draw. */
+    grad_fill_release(vg_lite_ctx::get_instance(), grad);
 
-            /* Pre-multiply the second color. */
-            color2[2] *= color2[3];
-            color2[1] *= color2[3];
-            color2[0] *= color2[3];
-        }
-
-        /* Filter the colors per channel. */
-        color[3] = LERP(color1[3], color2[3], weight);
-        color[2] = LERP(color1[2], color2[2], weight);
-        color[1] = LERP(color1[1], color2[1], weight);
-        color[0] = LERP(color1[0], color2[0], weight);
+    /* Share the color ramp surface with identical gradients. */
+    bool cached;
+    VG_LITE_RETURN_ERROR(grad_ramp_acquire(vg_lite_ctx::get_instance(), &grad->image, GRAD_RAMP_LINEAR, width, width,
+        color_ramp, ramp_length, grad->pre_multiplied, grad->spread_mode, &cached));
 
-        /* Pack the final color. */
-        *bits++ = PackColorComponent(color[3]);
-        *bits++ = PackColorComponent(color[2]);
-        *bits++ = PackColorComponent(color[1]);
-        *bits++ = PackColorComponent(color[0]);
+    if (cached) {
+        return VG_LITE_SUCCESS;
     }
 
-    return VG_LITE_SUCCESS;
+    return grad_ramp_fill((uint32_t*)grad->image.memory, width, color_ramp, grad->pre_multiplied);
 }
 
 vg_lite_error_t vg_lite_set_radial_grad(vg_lite_radial_gradient_t* grad,
@@ -1278,9 +2651,8 @@ vg_lite_error_t vg_lite_update_radial_grad(vg_lite_radial_gradient_t* grad)
 {
     uint32_t ramp_length;
     vg_lite_color_ramp_t* colorRamp;
-    uint32_t common, stop;
+    uint32_t common;
     uint32_t i, width;
-    uint8_t* bits;
     vg_lite_error_t error = VG_LITE_SUCCESS;
     uint32_t align, mul, div;
 
@@ -1317,96 +2689,23 @@ vg_lite_error_t vg_lite_update_radial_grad(vg_lite_radial_gradient_t* grad)
     width = common + 1;
     width = (width + 15) & (~0xf);
 
-    /* Allocate the color ramp surface. */
-    memset(&grad->image, 0, sizeof(grad->image));
-    grad->image.width = width;
-    grad->image.height = 1;
-    grad->image.stride = 0;
-    grad->image.image_mode = VG_LITE_NONE_IMAGE_MODE;
-    grad->image.format = VG_LITE_ABGR8888;
-
-    /* Allocate the image for gradient. */
-    VG_LITE_RETURN_ERROR(vg_lite_allocate(&grad->image));
+    /* The color stops of the drawing fill are rebuilt on the next draw. */
+    grad_fill_release(vg_lite_ctx::get_instance(), grad);
 
+    /* The whole stride of the ramp image is filled. */
     get_format_bytes(VG_LITE_ABGR8888, &mul, &div, &align);
-    width = grad->image.stride * div / mul;
-
-    /* Set pointer to color array. */
-    bits = (uint8_t*)grad->image.memory;
-
-    /* Start filling the color array. */
-    stop = 0;
-    for (i = 0; i < width; ++i) {
-        vg_lite_float_t gradient;
-        vg_lite_float_t color[4];
-        vg_lite_float_t color1[4];
-        vg_lite_float_t color2[4];
-        vg_lite_float_t weight;
-
-        /* Compute gradient for current color array entry. */
-        gradient = (vg_lite_float_t)i / (vg_lite_float_t)(width - 1);
-
-        /* Find the entry in the color ramp that matches or exceeds this
-        ** gradient. */
-        while (gradient > colorRamp[stop].stop) {
-            ++stop;
-        }
-
-        if (gradient == colorRamp[stop].stop) {
-            /* Perfect match weight 1.0. */
-            weight = 1.0f;
-
-            /* Use color ramp color. */
-            color1[3] = colorRamp[stop].alpha;
-            color1[2] = colorRamp[stop].blue;
-            color1[1] = colorRamp[stop].green;
-            color1[0] = colorRamp[stop].red;
-
-            color2[3] = color2[2] = color2[1] = color2[0] = 0.0f;
-        } else {
-            /* Compute weight. */
-            weight = (colorRamp[stop].stop - gradient)
-                / (colorRamp[stop].stop - colorRamp[stop - 1].stop);
-
-            /* Grab color ramp color of previous stop. */
-            color1[3] = colorRamp[stop - 1].alpha;
-            color1[2] = colorRamp[stop - 1].blue;
-            color1[1] = colorRamp[stop - 1].green;
-            color1[0] = colorRamp[stop - 1].red;
-
-            /* Grab color ramp color of current stop. */
-            color2[3] = colorRamp[stop].alpha;
-            color2[2] = colorRamp[stop].blue;
-            color2[1] = colorRamp[stop].green;
-            color2[0] = colorRamp[stop].red;
-        }
+    uint32_t fill_width = VG_LITE_ALIGN(width * mul / div, align) * div / mul;
 
-        if (grad->pre_multiplied) {
-            /* Pre-multiply the first color. */
-            color1[2] *= color1[3];
-            color1[1] *= color1[3];
-            color1[0] *= color1[3];
-
-            /* Pre-multiply the second color. */
-            color2[2] *= color2[3];
-            color2[1] *= color2[3];
-            color2[0] *= color2[3];
-        }
-
-        /* Filter the colors per channel. */
-        color[3] = LERP(color1[3], color2[3], weight);
-        color[2] = LERP(color1[2], color2[2], weight);
-        color[1] = LERP(color1[1], color2[1], weight);
-        color[0] = LERP(color1[0], color2[0], weight);
+    /* Share the color ramp surface with identical gradients. */
+    bool cached;
+    VG_LITE_RETURN_ERROR(grad_ramp_acquire(vg_lite_ctx::get_instance(), &grad->image, GRAD_RAMP_RADIAL, width, fill_width,
+        colorRamp, ramp_length, grad->pre_multiplied, grad->spread_mode, &cached));
 
-        /* Pack the final color. */
-        *bits++ = PackColorComponent(color[3]);
-        *bits++ = PackColorComponent(color[2]);
-        *bits++ = PackColorComponent(color[1]);
-        *bits++ = PackColorComponent(color[0]);
+    if (cached) {
+        return VG_LITE_SUCCESS;
     }
 
-    return VG_LITE_SUCCESS;
+    return grad_ramp_fill((uint32_t*)grad->image.memory, fill_width, colorRamp, grad->pre_multiplied);
 }
 
 vg_lite_error_t vg_lite_set_grad(vg_lite_linear_gradient_t* grad,
@@ -1444,12 +2743,7 @@ vg_lite_error_t vg_lite_set_grad(vg_lite_linear_gradient_t* grad,
 vg_lite_error_t vg_lite_update_grad(vg_lite_linear_gradient_t* grad)
 {
     vg_lite_error_t error = VG_LITE_SUCCESS;
-    int32_t r0, g0, b0, a0;
-    int32_t r1, g1, b1, a1;
-    int32_t lr, lg, lb, la;
     uint32_t i;
-    int32_t j;
-    int32_t ds, dr, dg, db, da;
     uint32_t* buffer = (uint32_t*)grad->image.memory;
 
 #ifdef CONFIG_VG_LITE_TVG_TRACE_API
@@ -1473,38 +2767,11 @@ vg_lite_error_t vg_lite_update_grad(vg_lite_linear_gradient_t* grad)
         for (i = 0; i < grad->stops[0]; i++)
             buffer[i] = grad->colors[0];
     }
-    a0 = A(grad->colors[0]);
-    r0 = R(grad->colors[0]);
-    g0 = G(grad->colors[0]);
-    b0 = B(grad->colors[0]);
-
     /* Calculate the colors for each pixel of the image. */
     for (i = 0; i < grad->count - 1; i++) {
         buffer[grad->stops[i]] = grad->colors[i];
-        ds = grad->stops[i + 1] - grad->stops[i];
-        a1 = A(grad->colors[i + 1]);
-        r1 = R(grad->colors[i + 1]);
-        g1 = G(grad->colors[i + 1]);
-        b1 = B(grad->colors[i + 1]);
-
-        da = a1 - a0;
-        dr = r1 - r0;
-        dg = g1 - g0;
-        db = b1 - b0;
-
-        for (j = 1; j < ds; j++) {
-            la = a0 + da * j / ds;
-            lr = r0 + dr * j / ds;
-            lg = g0 + dg * j / ds;
-            lb = b0 + db * j / ds;
-
-            buffer[grad->stops[i] + j] = ARGB(la, lr, lg, lb);
-        }
-
-        a0 = a1;
-        r0 = r1;
-        g0 = g1;
-        b0 = b1;
+        grad_ramp_fill_dda(buffer + grad->stops[i], grad->colors[i], grad->colors[i + 1],
+            grad->stops[i + 1] - grad->stops[i]);
     }
 
     /* If at least one valid stop has been specified, but none has been defined
@@ -1513,6 +2780,10 @@ vg_lite_error_t vg_lite_update_grad(vg_lite_linear_gradient_t* grad)
     for (i = grad->stops[grad->count - 1]; i < VLC_GRADIENT_BUFFER_WIDTH; i++)
         buffer[i] = grad->colors[grad->count - 1];
 
+    /* Compile the fill used by vg_lite_draw_grad(). */
+    Fill* fill;
+    TVG_CHECK_RETURN_VG_ERROR(grad_fill_compile(vg_lite_ctx::get_instance(), grad, &fill));
+
     return error;
 }
 
@@ -1525,9 +2796,11 @@ vg_lite_error_t vg_lite_clear_linear_grad(vg_lite_ext_linear_gradient_t* grad)
 #endif
 
     grad->count = 0;
-    /* Release the image resource. */
+    grad_fill_release(vg_lite_ctx::get_instance(), grad);
+
+    /* Release the image resource, it may be shared with other gradients. */
     if (grad->image.handle != NULL) {
-        error = vg_lite_free(&grad->image);
+        error = grad_ramp_release(vg_lite_ctx::get_instance(), &grad->image);
     }
 
     return error;
@@ -1542,6 +2815,8 @@ vg_lite_error_t vg_lite_clear_grad(vg_lite_linear_gradient_t* grad)
 #endif
 
     grad->count = 0;
+    grad_fill_release(vg_lite_ctx::get_instance(), grad);
+
     /* Release the image resource. */
     if (grad->image.handle != NULL) {
         error = vg_lite_free(&grad->image);
@@ -1559,9 +2834,11 @@ vg_lite_error_t vg_lite_clear_radial_grad(vg_lite_radial_gradient_t* grad)
 #endif
 
     grad->count = 0;
-    /* Release the image resource. */
+    grad_fill_release(vg_lite_ctx::get_instance(), grad);
+
+    /* Release the image resource, it may be shared with other gradients. */
     if (grad->image.handle != NULL) {
-        error = vg_lite_free(&grad->image);
+        error = grad_ramp_release(vg_lite_ctx::get_instance(), &grad->image);
     }
 
     return error;
@@ -1602,58 +2879,149 @@ vg_lite_error_t vg_lite_draw_grad(vg_lite_buffer_t* target,
     vg_lite_blend_t blend)
 {
     auto ctx = vg_lite_ctx::get_instance();
+
+    /* The gradient matrix places the ramp in target space. */
+    vg_lite_matrix_t grad_matrix;
+    if (!grad_fill_matrix(matrix, &grad->matrix, &grad_matrix)) {
+        /* The path collapses, nothing to draw. */
+        return VG_LITE_SUCCESS;
+    }
+
     TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
 
-    auto shape = Shape::gen();
-    TVG_CHECK_RETURN_VG_ERROR(shape_append_path(shape, path, matrix));
-    TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
-    TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)););
-    TVG_CHECK_RETURN_VG_ERROR(shape->blend(blend_method_conv(blend)));
+    /* compiled by vg_lite_update_grad() */
+    Fill* fill = grad_fill_find(ctx, grad, VG_LITE_GRADIENT_SPREAD_PAD, 0);
+    if (!fill) {
+        TVG_CHECK_RETURN_VG_ERROR(grad_fill_compile(ctx, grad, &fill));
+    }
 
-    float x_min = path->bounding_box[0];
-    float y_min = path->bounding_box[1];
-    float x_max = path->bounding_box[2];
-    float y_max = path->bounding_box[3];
+    std::unique_ptr<Fill> linearGrad(fill->duplicate());
+    TVG_CHECK_RETURN_VG_ERROR(linearGrad->transform(matrix_conv(&grad_matrix)));
+    TVG_CHECK_RETURN_VG_ERROR(shape_push_fill(ctx, target, path, fill_rule, matrix, blend, std::move(linearGrad)));
 
-    auto linearGrad = LinearGradient::gen();
+    return VG_LITE_SUCCESS;
+}
 
-    if (matrix->m[0][1] != 0) {
-        /* vertical */
-        linearGrad->linear(x_min, y_min, x_min, y_max);
-    } else {
-        /* horizontal */
-        linearGrad->linear(x_min, y_min, x_max, y_min);
+vg_lite_error_t vg_lite_draw_radial_grad(vg_lite_buffer_t* target,
+    vg_lite_path_t* path,
+    vg_lite_fill_t fill_rule,
+    vg_lite_matrix_t* path_matrix,
+    vg_lite_radial_gradient_t* grad,
+    vg_lite_color_t paint_color,
+    vg_lite_blend_t blend,
+    vg_lite_filter_t filter)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_draw_radial_grad %p %p %d %p %p 0x%08X %d %d\n",
+        target, path, fill_rule, path_matrix, grad, (int)paint_color, blend, filter);
+#endif
+
+    auto ctx = vg_lite_ctx::get_instance();
+
+    if (grad->converted_length == 0) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* ThorVG radial gradients have no focal point, one off the center is refused */
+    if (!math_equal(grad->radial_grad.fx, grad->radial_grad.cx) || !math_equal(grad->radial_grad.fy, grad->radial_grad.cy)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    /* The gradient is placed in target space, the fill in the path space. */
+    vg_lite_matrix_t grad_matrix;
+    if (!grad_fill_matrix(path_matrix, &grad->matrix, &grad_matrix)) {
+        /* The path collapses, nothing to draw. */
+        return VG_LITE_SUCCESS;
     }
 
-    linearGrad->transform(matrix_conv(&grad->matrix));
-    linearGrad->spread(FillSpread::Reflect);
+    TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
+
+    Fill* fill = grad_fill_find(ctx, grad, grad->spread_mode, paint_color);
+    if (!fill) {
+        auto radialGrad = RadialGradient::gen();
+        fill = radialGrad.get();
+        TVG_CHECK_RETURN_VG_ERROR(grad_fill_store(ctx, grad, std::move(radialGrad), GRAD_RAMP_RADIAL,
+            grad->converted_ramp, grad->converted_length, grad->pre_multiplied, grad->spread_mode, paint_color));
+    }
 
-    tvg::Fill::ColorStop colorStops[VLC_MAX_GRADIENT_STOPS];
-    for (vg_lite_uint32_t i = 0; i < grad->count; i++) {
-        colorStops[i].offset = grad->stops[i] / 255.0f;
-        colorStops[i].r = R(grad->colors[i]);
-        colorStops[i].g = G(grad->colors[i]);
-        colorStops[i].b = B(grad->colors[i]);
-        colorStops[i].a = A(grad->colors[i]);
+    /* ThorVG gradients are sampled analytically, the filter does not apply. */
+    float r = grad->radial_grad.r;
+    if (grad->spread_mode == VG_LITE_GRADIENT_SPREAD_FILL) {
+        r *= 1.0f + GRAD_FILL_SPREAD_FILL_MARGIN;
     }
-    TVG_CHECK_RETURN_VG_ERROR(linearGrad->colorStops(colorStops, grad->count));
 
-    TVG_CHECK_RETURN_VG_ERROR(shape->fill(std::move(linearGrad)));
-    TVG_CHECK_RETURN_VG_ERROR(ctx->canvas->push(std::move(shape)));
+    std::unique_ptr<RadialGradient> radialGrad((RadialGradient*)fill->duplicate());
+    TVG_CHECK_RETURN_VG_ERROR(radialGrad->radial(grad->radial_grad.cx, grad->radial_grad.cy, r));
+    TVG_CHECK_RETURN_VG_ERROR(radialGrad->transform(matrix_conv(&grad_matrix)));
+    TVG_CHECK_RETURN_VG_ERROR(shape_push_fill(ctx, target, path, fill_rule, path_matrix, blend, std::move(radialGrad)));
 
     return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_draw_radial_grad(vg_lite_buffer_t* target,
+vg_lite_error_t vg_lite_draw_linear_grad(vg_lite_buffer_t* target,
     vg_lite_path_t* path,
     vg_lite_fill_t fill_rule,
     vg_lite_matrix_t* path_matrix,
-    vg_lite_radial_gradient_t* grad,
+    vg_lite_ext_linear_gradient_t* grad,
     vg_lite_color_t paint_color,
     vg_lite_blend_t blend,
     vg_lite_filter_t filter)
 {
-    return VG_LITE_NOT_SUPPORT;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_draw_linear_grad %p %p %d %p %p 0x%08X %d %d\n",
+        target, path, fill_rule, path_matrix, grad, (int)paint_color, blend, filter);
+#endif
+
+    auto ctx = vg_lite_ctx::get_instance();
+
+    if (grad->converted_length == 0) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* The gradient is placed in target space, the fill in the path space. */
+    vg_lite_matrix_t grad_matrix;
+    if (!grad_fill_matrix(path_matrix, &grad->matrix, &grad_matrix)) {
+        /* The path collapses, nothing to draw. */
+        return VG_LITE_SUCCESS;
+    }
+
+    TVG_CHECK_RETURN_VG_ERROR(canvas_set_target(ctx, target));
+
+    bool drawn;
+    TVG_CHECK_RETURN_VG_ERROR(grad_axis_push(ctx, grad, path, fill_rule, path_matrix, blend, &drawn));
+    if (drawn) {
+        return VG_LITE_SUCCESS;
+    }
+
+    float x0 = grad->linear_grad.X0;
+    float y0 = grad->linear_grad.Y0;
+    float x1 = grad->linear_grad.X1;
+    float y1 = grad->linear_grad.Y1;
+
+    Fill* fill = grad_fill_find(ctx, grad, grad->spread_mode, paint_color);
+    if (!fill) {
+        auto linearGrad = LinearGradient::gen();
+        fill = linearGrad.get();
+        TVG_CHECK_RETURN_VG_ERROR(grad_fill_store(ctx, grad, std::move(linearGrad), GRAD_RAMP_LINEAR,
+            grad->converted_ramp, grad->converted_length, grad->pre_multiplied, grad->spread_mode, paint_color));
+    }
+
+    if (grad->spread_mode == VG_LITE_GRADIENT_SPREAD_FILL) {
+        float dx = (x1 - x0) * GRAD_FILL_SPREAD_FILL_MARGIN;
+        float dy = (y1 - y0) * GRAD_FILL_SPREAD_FILL_MARGIN;
+        x0 -= dx;
+        y0 -= dy;
+        x1 += dx;
+        y1 += dy;
+    }
+
+    /* ThorVG gradients are sampled analytically, the filter does not apply. */
+    std::unique_ptr<LinearGradient> linearGrad((LinearGradient*)fill->duplicate());
+    TVG_CHECK_RETURN_VG_ERROR(linearGrad->linear(x0, y0, x1, y1));
+    TVG_CHECK_RETURN_VG_ERROR(linearGrad->transform(matrix_conv(&grad_matrix)));
+    TVG_CHECK_RETURN_VG_ERROR(shape_push_fill(ctx, target, path, fill_rule, path_matrix, blend, std::move(linearGrad)));
+
+    return VG_LITE_SUCCESS;
 }
 
 vg_lite_error_t vg_lite_set_command_buffer_size(uint32_t size)
@@ -1663,185 +3031,923 @@ vg_lite_error_t vg_lite_set_command_buffer_size(uint32_t size)
 
 vg_lite_error_t vg_lite_set_scissor(int32_t x, int32_t y, int32_t right, int32_t bottom)
 {
-    return VG_LITE_NOT_SUPPORT;
-}
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_scissor %" PRId32 " %" PRId32 " %" PRId32 " %" PRId32 "\n", x, y, right, bottom);
+#endif
 
-vg_lite_error_t vg_lite_enable_scissor(void)
-{
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_rectangle_t rect = { x, y, MAX(right - x, 0), MAX(bottom - y, 0) };
+    vg_lite_ctx::get_instance()->set_scissor(&rect, 1);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_disable_scissor(void)
+vg_lite_error_t vg_lite_scissor_rects(vg_lite_uint32_t nums, vg_lite_rectangle_t rect[])
 {
-    return VG_LITE_NOT_SUPPORT;
-}
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_scissor_rects %" PRIu32 " %p\n", nums, rect);
+#endif
 
-vg_lite_error_t vg_lite_get_mem_size(uint32_t* size)
-{
-    *size = 0;
-    return VG_LITE_NOT_SUPPORT;
-}
+    if (!nums || !rect) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-vg_lite_error_t vg_lite_source_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
-{
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_ctx::get_instance()->set_scissor(rect, nums);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_dest_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+vg_lite_error_t vg_lite_enable_scissor(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_ctx::get_instance()->enable_scissor(true);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_set_color_key(vg_lite_color_key4_t colorkey)
+vg_lite_error_t vg_lite_disable_scissor(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_ctx::get_instance()->enable_scissor(false);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_set_flexa_stream_id(uint8_t stream_id)
+vg_lite_error_t vg_lite_set_pixel_matrix(vg_lite_pixel_matrix_t matrix, vg_lite_pixel_channel_enable_t* channel)
 {
-    return VG_LITE_NOT_SUPPORT;
-}
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_pixel_matrix %p %p\n", matrix, channel);
+#endif
 
-vg_lite_error_t vg_lite_set_flexa_current_background_buffer(uint8_t stream_id,
-    vg_lite_buffer_t* buffer,
-    uint32_t background_segment_count,
-    uint32_t background_segment_size)
-{
-    return VG_LITE_NOT_SUPPORT;
-}
+    if (!matrix || !channel) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-vg_lite_error_t vg_lite_enable_flexa(void)
-{
-    return VG_LITE_NOT_SUPPORT;
+    pixel_matrix_t pixel_matrix;
+    const bool enable[4] = { channel->enable_a != 0, channel->enable_r != 0, channel->enable_g != 0, channel->enable_b != 0 };
+    bool active;
+    if (!pixel_matrix_build(&pixel_matrix, matrix, enable, &active)) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* identity matrices cost nothing while decoding */
+    vg_lite_ctx::get_instance()->set_pixel_matrix(active ? &pixel_matrix : nullptr);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_disable_flexa(void)
+vg_lite_error_t vg_lite_enable_color_transform(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_enable_color_transform\n");
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_COLOR_TRANSFORMATION)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_ctx::get_instance()->enable_color_transform(true);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_set_flexa_stop_frame(void)
+vg_lite_error_t vg_lite_disable_color_transform(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_disable_color_transform\n");
+#endif
+
+    vg_lite_ctx::get_instance()->enable_color_transform(false);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_enable_dither(void)
+vg_lite_error_t vg_lite_set_color_transform(vg_lite_color_transform_t* values)
 {
-    return VG_LITE_NOT_SUPPORT;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_color_transform %p\n", values);
+#endif
+
+    if (!values) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* image pixels go through the diagonal pixel matrix, biases are normalized like its offsets */
+    const vg_lite_float_t m[20] = {
+        values->a_scale, 0, 0, 0, values->a_bias,
+        0, values->r_scale, 0, 0, values->r_bias,
+        0, 0, values->g_scale, 0, values->g_bias,
+        0, 0, 0, values->b_scale, values->b_bias
+    };
+    const bool enable[4] = { true, true, true, true };
+    pixel_matrix_t matrix;
+    bool active;
+    if (!pixel_matrix_build(&matrix, m, enable, &active)) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    vg_lite_ctx::get_instance()->set_color_transform(values, active ? &matrix : nullptr);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_disable_dither(void)
+vg_lite_error_t vg_lite_gaussian_filter(vg_lite_float_t w0, vg_lite_float_t w1, vg_lite_float_t w2)
 {
-    return VG_LITE_NOT_SUPPORT;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_gaussian_filter %f %f %f\n", w0, w1, w2);
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_GAUSSIAN_BLUR)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    vg_lite_float_t sum = w0 + 4 * w1 + 4 * w2;
+    if (w0 < 0 || w1 < 0 || w2 < 0 || sum <= 0) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* normalized, rounding down the edge weights leaves the rest to the center */
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->gauss_weights[1] = (int32_t)(w1 * 256 / sum);
+    ctx->gauss_weights[2] = (int32_t)(w2 * 256 / sum);
+    ctx->gauss_weights[0] = 256 - 4 * ctx->gauss_weights[1] - 4 * ctx->gauss_weights[2];
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_set_tess_buffer(uint32_t physical, uint32_t size)
+vg_lite_error_t vg_lite_enable_masklayer(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_ctx::get_instance()->enable_mask(true);
+    return VG_LITE_SUCCESS;
 }
 
-vg_lite_error_t vg_lite_set_command_buffer(uint32_t physical, uint32_t size)
+vg_lite_error_t vg_lite_disable_masklayer(void)
 {
-    return VG_LITE_NOT_SUPPORT;
+    vg_lite_ctx::get_instance()->enable_mask(false);
+    return VG_LITE_SUCCESS;
 }
-} /* extern "C" */
-
-/**********************
- *   STATIC FUNCTIONS
- **********************/
 
-static vg_lite_error_t vg_lite_error_conv(Result result)
+vg_lite_error_t vg_lite_set_masklayer(vg_lite_buffer_t* masklayer)
 {
-    switch (result) {
-    case Result::Success:
-        return VG_LITE_SUCCESS;
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_masklayer %p\n", masklayer);
+#endif
 
-    case Result::InvalidArguments:
+    if (!masklayer || masklayer->format != VG_LITE_A8) {
         return VG_LITE_INVALID_ARGUMENT;
+    }
 
-    case Result::InsufficientCondition:
-        return VG_LITE_OUT_OF_RESOURCES;
+    vg_lite_ctx::get_instance()->set_mask(masklayer);
+    return VG_LITE_SUCCESS;
+}
 
-    case Result::FailedAllocation:
-        return VG_LITE_OUT_OF_MEMORY;
+vg_lite_error_t vg_lite_destroy_masklayer(vg_lite_buffer_t* masklayer)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_destroy_masklayer %p\n", masklayer);
+#endif
 
-    case Result::NonSupport:
-        return VG_LITE_NOT_SUPPORT;
+    if (!masklayer || !masklayer->memory) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-    default:
-        break;
+    /* Pending paints use the ARGB copy, not the layer itself. The layer is
+     * dropped even while the mask is disabled, enabling it again must not
+     * read the freed memory. */
+    auto ctx = vg_lite_ctx::get_instance();
+    if (ctx->is_mask(masklayer->memory)) {
+        ctx->set_mask(nullptr);
     }
 
-    return VG_LITE_TIMEOUT;
+    return vg_lite_free(masklayer);
 }
 
-static Matrix matrix_conv(const vg_lite_matrix_t* matrix)
+vg_lite_error_t vg_lite_create_masklayer(vg_lite_buffer_t* masklayer, vg_lite_uint32_t width, vg_lite_uint32_t height)
 {
-    return *(Matrix*)matrix;
-}
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_create_masklayer %p %" PRIu32 "x%" PRIu32 "\n", masklayer, width, height);
+#endif
 
-static FillRule fill_rule_conv(vg_lite_fill_t fill)
-{
-    if (fill == VG_LITE_FILL_EVEN_ODD) {
-        return FillRule::EvenOdd;
+    if (!masklayer || !width || !height) {
+        return VG_LITE_INVALID_ARGUMENT;
     }
 
-    return FillRule::Winding;
+    memset(masklayer, 0, sizeof(vg_lite_buffer_t));
+    masklayer->width = width;
+    masklayer->height = height;
+    masklayer->format = VG_LITE_A8;
+
+    vg_lite_error_t error;
+    VG_LITE_RETURN_ERROR(vg_lite_allocate(masklayer));
+
+    int32_t area[4];
+    mask_area(masklayer, nullptr, area);
+    mask_fill(masklayer, area, 0xff);
+    return VG_LITE_SUCCESS;
 }
 
-static BlendMethod blend_method_conv(vg_lite_blend_t blend)
+vg_lite_error_t vg_lite_fill_masklayer(vg_lite_buffer_t* masklayer, vg_lite_rectangle_t* rect, vg_lite_uint8_t value)
 {
-    switch (blend) {
-    case VG_LITE_BLEND_NONE:
-        return BlendMethod::SrcOver;
+    if (!masklayer || masklayer->format != VG_LITE_A8) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-    case VG_LITE_BLEND_NORMAL_LVGL:
-        return BlendMethod::Normal;
+    int32_t area[4];
+    if (mask_area(masklayer, rect, area)) {
+        auto ctx = vg_lite_ctx::get_instance();
+        ctx->mask_write_begin(masklayer->memory);
+        mask_fill(masklayer, area, value);
+        ctx->mask_changed(masklayer->memory);
+    }
 
-    case VG_LITE_BLEND_SRC_OVER:
-        return BlendMethod::Normal;
+    return VG_LITE_SUCCESS;
+}
 
-    case VG_LITE_BLEND_SCREEN:
-        return BlendMethod::Screen;
+vg_lite_error_t vg_lite_blend_masklayer(vg_lite_buffer_t* dst,
+    vg_lite_buffer_t* src,
+    vg_lite_mask_operation_t operation,
+    vg_lite_rectangle_t* rect)
+{
+    if (!dst || !src || dst->format != VG_LITE_A8 || src->format != VG_LITE_A8) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-    case VG_LITE_BLEND_ADDITIVE:
-        return BlendMethod::Add;
+    int32_t area[4];
+    mask_area(dst, rect, area);
+    area[2] = MIN(area[2], src->width);
+    area[3] = MIN(area[3], src->height);
+    if (area[0] >= area[2] || area[1] >= area[3]) {
+        return VG_LITE_SUCCESS;
+    }
 
-    case VG_LITE_BLEND_MULTIPLY:
-        return BlendMethod::Multiply;
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->mask_write_begin(dst->memory);
 
-    default:
-        break;
+    for (int32_t y = area[1]; y < area[3]; y++) {
+        uint8_t* dst_line = (uint8_t*)dst->memory + y * dst->stride + area[0];
+        const uint8_t* src_line = (const uint8_t*)src->memory + y * src->stride + area[0];
+        mask_blend_span(dst_line, src_line, area[2] - area[0], operation);
     }
 
-    return BlendMethod::Normal;
+    ctx->mask_changed(dst->memory);
+    return VG_LITE_SUCCESS;
 }
 
-static float vlc_get_arg(const void* data, vg_lite_format_t format)
+vg_lite_error_t vg_lite_render_masklayer(vg_lite_buffer_t* masklayer,
+    vg_lite_mask_operation_t operation,
+    vg_lite_path_t* path,
+    vg_lite_fill_t fill_rule,
+    vg_lite_color_t color,
+    vg_lite_matrix_t* matrix)
 {
-    switch (format) {
-    case VG_LITE_S8:
-        return *((int8_t*)data);
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_render_masklayer %p %d %p %d 0x%08" PRIx32 " %p\n",
+        masklayer, operation, path, fill_rule, color, matrix);
+#endif
 
-    case VG_LITE_S16:
-        return *((int16_t*)data);
+    if (!masklayer || masklayer->format != VG_LITE_A8 || !path || !matrix) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
 
-    case VG_LITE_S32:
-        return *((int32_t*)data);
+    auto ctx = vg_lite_ctx::get_instance();
+    int32_t width = masklayer->width;
+    int32_t height = masklayer->height;
+    int32_t bounds[4];
+
+    /* the path coverage is the source mask, 0 outside of the path bounds */
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, matrix);
+
+    if (operation == VG_LITE_CLEAR_MASK || operation == VG_LITE_FILL_MASK
+        || !path_raster_device_bounds(raster, bounds)) {
+        bounds[0] = bounds[1] = 0;
+        bounds[2] = width;
+        bounds[3] = height;
+    } else {
+        bounds[0] = MAX(bounds[0], 0);
+        bounds[1] = MAX(bounds[1], 0);
+        bounds[2] = MIN(bounds[2], width);
+        bounds[3] = MIN(bounds[3], height);
+    }
 
-    case VG_LITE_FP32:
-        return *((float*)data);
+    uint32_t* buffer = nullptr;
+    bool covered = bounds[0] < bounds[2] && bounds[1] < bounds[3]
+        && operation != VG_LITE_CLEAR_MASK && operation != VG_LITE_FILL_MASK;
 
-    default:
-        TVG_LOG("UNKNOW_FORMAT: %d\n", format);
-        break;
+    if (covered) {
+        SwCanvas* canvas = ctx->get_mask_canvas(width, height, &buffer);
+        for (int32_t y = bounds[1]; y < bounds[3]; y++) {
+            memset(buffer + y * width + bounds[0], 0, (bounds[2] - bounds[0]) * sizeof(uint32_t));
+        }
+
+        auto shape = Shape::gen();
+        TVG_CHECK_RETURN_VG_ERROR(shape_append_raster(shape.get(), raster, path));
+        TVG_CHECK_RETURN_VG_ERROR(shape->transform(matrix_conv(matrix)));
+        TVG_CHECK_RETURN_VG_ERROR(shape->fill(fill_rule_conv(fill_rule)));
+        TVG_CHECK_RETURN_VG_ERROR(shape->fill(0xff, 0xff, 0xff, A(color)));
+
+        TVG_CHECK_RETURN_VG_ERROR(canvas->target(buffer, width, width, height, SwCanvas::ARGB8888));
+        TVG_CHECK_RETURN_VG_ERROR(canvas->push(std::move(shape)));
+        TVG_CHECK_RETURN_VG_ERROR(canvas->draw());
+        TVG_CHECK_RETURN_VG_ERROR(canvas->sync());
+        TVG_CHECK_RETURN_VG_ERROR(canvas->clear(true));
     }
 
-    return 0;
-}
+    ctx->mask_write_begin(masklayer->memory);
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* line = (uint8_t*)masklayer->memory + y * masklayer->stride;
 
-static uint8_t vlc_format_len(vg_lite_format_t format)
-{
+        if (!covered || y < bounds[1] || y >= bounds[3]) {
+            mask_blend_span(line, nullptr, width, operation);
+            continue;
+        }
+
+        /* the coverage is packed in place, behind the pixels already read */
+        uint32_t* pixels = buffer + y * width + bounds[0];
+        mask_alpha_span((uint8_t*)pixels, pixels, bounds[2] - bounds[0]);
+
+        mask_blend_span(line, nullptr, bounds[0], operation);
+        mask_blend_span(line + bounds[0], (const uint8_t*)pixels, bounds[2] - bounds[0], operation);
+        mask_blend_span(line + bounds[2], nullptr, width - bounds[2], operation);
+    }
+
+    ctx->mask_changed(masklayer->memory);
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_get_mem_size(uint32_t* size)
+{
+    *size = 0;
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_source_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_source_global_alpha %d 0x%02x\n", alpha_mode, alpha_value);
+#endif
+
+    if (alpha_mode > VG_LITE_SCALED) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* VG_LITE_SCALED becomes the paint opacity, VG_LITE_GLOBAL replaces the
+     * alpha of the source pixels while they are decoded.
+     */
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->src_alpha_mode = alpha_mode;
+    ctx->src_alpha_value = alpha_value;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_dest_global_alpha(vg_lite_global_alpha_t alpha_mode, uint8_t alpha_value)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_dest_global_alpha %d 0x%02x\n", alpha_mode, alpha_value);
+#endif
+
+    if (alpha_mode > VG_LITE_SCALED) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* applied to the target alpha by vg_lite_finish() */
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->dst_alpha_mode = alpha_mode;
+    ctx->dst_alpha_value = alpha_value;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_color_key(vg_lite_color_key4_t colorkey)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_color_key %p\n", colorkey);
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_COLOR_KEY)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->set_color_key(colorkey);
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_flexa_stream_id(uint8_t stream_id)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_set_flexa_current_background_buffer(uint8_t stream_id,
+    vg_lite_buffer_t* buffer,
+    uint32_t background_segment_count,
+    uint32_t background_segment_size)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_enable_flexa(void)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_disable_flexa(void)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_set_flexa_stop_frame(void)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_enable_dither(void)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_enable_dither\n");
+#endif
+
+    /* applied by the resolve in vg_lite_finish() */
+    vg_lite_ctx::get_instance()->dither_enabled = true;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_disable_dither(void)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_disable_dither\n");
+#endif
+
+    vg_lite_ctx::get_instance()->dither_enabled = false;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_mirror(vg_lite_orientation_t orientation)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_mirror %d\n", orientation);
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_MIRROR)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    if (orientation != VG_LITE_ORIENTATION_TOP_BOTTOM && orientation != VG_LITE_ORIENTATION_BOTTOM_TOP) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    if (ctx->orientation != orientation) {
+        /* pending paints keep the orientation they were drawn with */
+        vg_lite_error_t error = vg_lite_finish();
+        if (error != VG_LITE_SUCCESS) {
+            return error;
+        }
+        ctx->orientation = orientation;
+    }
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_gamma(vg_lite_gamma_conversion_t gamma_value)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_gamma %d\n", gamma_value);
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_GAMMA)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    if (gamma_value < VG_LITE_GAMMA_NO_CONVERSION || gamma_value > VG_LITE_GAMMA_NON_LINEAR) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* images are decoded when drawn, pending ones keep their pixels */
+    auto ctx = vg_lite_ctx::get_instance();
+    ctx->gamma = gamma_value;
+    picture_gamma_update(ctx);
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_premultiply(vg_lite_uint8_t src_premult, vg_lite_uint8_t dst_premult)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_set_premultiply %d %d\n", src_premult, dst_premult);
+#endif
+
+    if (!vg_lite_query_feature(gcFEATURE_BIT_VG_HW_PREMULTIPLY)) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    if (ctx->dst_premultiplied != !!dst_premult) {
+        /* pending paints are resolved into the target as it was */
+        vg_lite_error_t error = vg_lite_finish();
+        if (error != VG_LITE_SUCCESS) {
+            return error;
+        }
+        ctx->dst_premultiplied = !!dst_premult;
+    }
+    ctx->src_premultiplied = !!src_premult;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_set_tess_buffer(uint32_t physical, uint32_t size)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_set_command_buffer(uint32_t physical, uint32_t size)
+{
+    return VG_LITE_NOT_SUPPORT;
+}
+
+vg_lite_error_t vg_lite_tvg_path_pack_open(vg_lite_tvg_path_pack_t* pack, const void* data, vg_lite_uint32_t size)
+{
+    if (!pack || !data || !VG_LITE_IS_ALIGNED(data, sizeof(vg_lite_float_t))) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    auto header = (const vg_lite_tvg_path_pack_header_t*)data;
+    if (size < sizeof(*header)
+        || header->magic != VG_LITE_TVG_PATH_PACK_MAGIC
+        || header->version != VG_LITE_TVG_PATH_PACK_VERSION
+        || header->size > size
+        || header->path_count > (header->size - sizeof(*header)) / sizeof(vg_lite_tvg_path_pack_entry_t)) {
+        TVG_LOG("invalid path pack: %p size %" PRIu32 "\n", data, size);
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    size = header->size;
+    auto entries = (const vg_lite_tvg_path_pack_entry_t*)(header + 1);
+
+    /* Validate everything once here, so drawing a packed path never
+     * parses or checks anything.
+     */
+    for (uint32_t i = 0; i < header->path_count; i++) {
+        const vg_lite_tvg_path_pack_entry_t* entry = &entries[i];
+
+        if (entry->cmd_offset > size || entry->cmd_count > size - entry->cmd_offset
+            || entry->pt_offset > size || entry->pt_count > (size - entry->pt_offset) / (2 * sizeof(vg_lite_float_t))
+            || !VG_LITE_IS_ALIGNED(entry->pt_offset, sizeof(vg_lite_float_t))) {
+            TVG_LOG("path pack entry %" PRIu32 " out of range\n", i);
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        const uint8_t* cmds = (const uint8_t*)data + entry->cmd_offset;
+        uint32_t pt_count = 0;
+        for (uint32_t j = 0; j < entry->cmd_count; j++) {
+            switch (cmds[j]) {
+            case VG_LITE_TVG_PATH_CMD_CLOSE:
+                break;
+            case VG_LITE_TVG_PATH_CMD_MOVE:
+            case VG_LITE_TVG_PATH_CMD_LINE:
+                pt_count += 1;
+                break;
+            case VG_LITE_TVG_PATH_CMD_CUBIC:
+                pt_count += 3;
+                break;
+            default:
+                TVG_LOG("path pack entry %" PRIu32 " has invalid command: %d\n", i, cmds[j]);
+                return VG_LITE_INVALID_ARGUMENT;
+            }
+        }
+
+        if (pt_count != entry->pt_count) {
+            TVG_LOG("path pack entry %" PRIu32 " point count mismatch\n", i);
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+    }
+
+    memset(pack, 0, sizeof(*pack));
+    pack->header = header;
+    pack->entries = entries;
+    pack->size = size;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_path_pack_map(vg_lite_tvg_path_pack_t* pack, const char* filename)
+{
+    if (!pack || !filename) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        TVG_LOG("open %s failed: %d\n", filename, errno);
+        return VG_LITE_GENERIC_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0 || (uint64_t)st.st_size > UINT32_MAX) {
+        close(fd);
+        return VG_LITE_GENERIC_IO;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        TVG_LOG("mmap %s failed: %d\n", filename, errno);
+        return VG_LITE_OUT_OF_RESOURCES;
+    }
+
+    vg_lite_error_t error = vg_lite_tvg_path_pack_open(pack, data, (uint32_t)st.st_size);
+    if (error != VG_LITE_SUCCESS) {
+        munmap(data, st.st_size);
+        return error;
+    }
+
+    pack->map_size = (uint32_t)st.st_size;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_path_pack_unmap(vg_lite_tvg_path_pack_t* pack)
+{
+    if (!pack || !pack->header || !pack->map_size) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    munmap((void*)pack->header, pack->map_size);
+    memset(pack, 0, sizeof(*pack));
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_path_pack_get_path(const vg_lite_tvg_path_pack_t* pack,
+    vg_lite_uint32_t index,
+    vg_lite_path_t* path,
+    vg_lite_fill_t* fill_rule)
+{
+    if (!pack || !pack->header || !path || index >= pack->header->path_count) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    const vg_lite_tvg_path_pack_entry_t* entry = &pack->entries[index];
+
+    vg_lite_error_t error;
+    VG_LITE_RETURN_ERROR(vg_lite_init_path(path, VG_LITE_FP32, VG_LITE_HIGH, 0, NULL,
+        entry->bounding_box[0], entry->bounding_box[1], entry->bounding_box[2], entry->bounding_box[3]));
+
+    path->uploaded.handle = (void*)pack->header;
+    path->uploaded.memory = (void*)entry;
+    path->uploaded.bytes = sizeof(*entry);
+
+    if (fill_rule) {
+        *fill_rule = (vg_lite_fill_t)entry->fill_rule;
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_path_bake(const vg_lite_path_t* path, const vg_lite_matrix_t* matrix, vg_lite_path_t* baked)
+{
+    if (!path || !matrix || !baked) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, matrix);
+
+    /* the bounding box clip has to stay a rectangle in device space */
+    bool need_clip = path_raster_need_clip(raster, path);
+    if (need_clip && raster->matrix_type > VG_LITE_TVG_MATRIX_SCALE) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+
+    /* a single entry pack: header, entry, points, commands */
+    uint32_t pt_offset = sizeof(vg_lite_tvg_path_pack_header_t) + sizeof(vg_lite_tvg_path_pack_entry_t);
+    uint32_t cmd_offset = pt_offset + raster->pt_count * sizeof(Point);
+    uint32_t size = cmd_offset + raster->cmd_count;
+
+    auto header = (vg_lite_tvg_path_pack_header_t*)malloc(size);
+    if (!header) {
+        return VG_LITE_OUT_OF_MEMORY;
+    }
+
+    auto entry = (vg_lite_tvg_path_pack_entry_t*)(header + 1);
+    auto pts = (vg_lite_float_t*)((uint8_t*)header + pt_offset);
+    auto cmds = (uint8_t*)header + cmd_offset;
+
+    header->magic = PATH_BAKE_MAGIC;
+    header->version = VG_LITE_TVG_PATH_PACK_VERSION;
+    header->path_count = 1;
+    header->size = size;
+
+    vg_lite_tvg_transform_points(matrix, (const vg_lite_float_t*)raster->pt_data, pts, raster->pt_count);
+
+    for (uint32_t i = 0; i < raster->cmd_count; i++) {
+        cmds[i] = (uint8_t)raster->cmd_data[i];
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->bounds[0] = entry->bounds[1] = raster->pt_count ? FLT_MAX : 0;
+    entry->bounds[2] = entry->bounds[3] = raster->pt_count ? -FLT_MAX : 0;
+    for (uint32_t i = 0; i < raster->pt_count; i++) {
+        entry->bounds[0] = MIN(entry->bounds[0], pts[i * 2]);
+        entry->bounds[1] = MIN(entry->bounds[1], pts[i * 2 + 1]);
+        entry->bounds[2] = MAX(entry->bounds[2], pts[i * 2]);
+        entry->bounds[3] = MAX(entry->bounds[3], pts[i * 2 + 1]);
+    }
+
+    if (need_clip) {
+        vg_lite_float_t box[4];
+        vg_lite_tvg_transform_points(matrix, path->bounding_box, box, 2);
+        entry->bounding_box[0] = MIN(box[0], box[2]);
+        entry->bounding_box[1] = MIN(box[1], box[3]);
+        entry->bounding_box[2] = MAX(box[0], box[2]);
+        entry->bounding_box[3] = MAX(box[1], box[3]);
+    } else {
+        memcpy(entry->bounding_box, entry->bounds, sizeof(entry->bounding_box));
+    }
+
+    entry->fill_rule = VG_LITE_FILL_NON_ZERO;
+    entry->cmd_count = raster->cmd_count;
+    entry->cmd_offset = cmd_offset;
+    entry->pt_count = raster->pt_count;
+    entry->pt_offset = pt_offset;
+
+    vg_lite_error_t error;
+    VG_LITE_RETURN_ERROR(vg_lite_init_path(baked, VG_LITE_FP32, VG_LITE_HIGH, 0, NULL,
+        entry->bounding_box[0], entry->bounding_box[1], entry->bounding_box[2], entry->bounding_box[3]));
+
+    baked->uploaded.handle = header;
+    baked->uploaded.memory = entry;
+    baked->uploaded.bytes = sizeof(*entry);
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_path_bake_free(vg_lite_path_t* baked)
+{
+    if (!baked || !path_is_compiled(baked)) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    /* paths of a path pack point into memory the pack owns */
+    auto header = (const vg_lite_tvg_path_pack_header_t*)baked->uploaded.handle;
+    if (header->magic != PATH_BAKE_MAGIC || baked->uploaded.memory != header + 1) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    free(baked->uploaded.handle);
+    baked->uploaded.handle = NULL;
+    baked->uploaded.memory = NULL;
+    baked->uploaded.bytes = 0;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_set_rotation(vg_lite_tvg_rotation_t rotation)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_tvg_set_rotation %d\n", rotation);
+#endif
+
+    if (rotation < VG_LITE_TVG_ROTATION_0 || rotation > VG_LITE_TVG_ROTATION_270) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    if (ctx->rotation != rotation) {
+        /* pending paints were drawn for the old canvas size */
+        vg_lite_error_t error = vg_lite_finish();
+        if (error != VG_LITE_SUCCESS) {
+            return error;
+        }
+        ctx->rotation = rotation;
+    }
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_set_linear_blend(vg_lite_uint8_t enable)
+{
+#ifdef CONFIG_VG_LITE_TVG_TRACE_API
+    VGLITE_LOG("vg_lite_tvg_set_linear_blend %d\n", enable);
+#endif
+
+#ifndef CONFIG_VG_LITE_TVG_LINEAR_BLEND
+    if (enable) {
+        return VG_LITE_NOT_SUPPORT;
+    }
+#endif
+
+    auto ctx = vg_lite_ctx::get_instance();
+    if (ctx->linear_blend != !!enable) {
+        /* pending paints are blended in the light they were drawn in */
+        vg_lite_error_t error = vg_lite_finish();
+        if (error != VG_LITE_SUCCESS) {
+            return error;
+        }
+        ctx->linear_blend = !!enable;
+        picture_gamma_update(ctx);
+
+        /* the cached gradients hold their stops in the old light */
+        ctx->get_grad_fills()->clear();
+    }
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_get_stats(vg_lite_tvg_stats_t* stats)
+{
+    if (!stats) {
+        return VG_LITE_INVALID_ARGUMENT;
+    }
+
+    auto ctx = vg_lite_ctx::get_instance();
+    *stats = ctx->stats;
+    return VG_LITE_SUCCESS;
+}
+
+vg_lite_error_t vg_lite_tvg_reset_stats(void)
+{
+    auto ctx = vg_lite_ctx::get_instance();
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    return VG_LITE_SUCCESS;
+}
+} /* extern "C" */
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static vg_lite_error_t vg_lite_error_conv(Result result)
+{
+    switch (result) {
+    case Result::Success:
+        return VG_LITE_SUCCESS;
+
+    case Result::InvalidArguments:
+        return VG_LITE_INVALID_ARGUMENT;
+
+    case Result::InsufficientCondition:
+        return VG_LITE_OUT_OF_RESOURCES;
+
+    case Result::FailedAllocation:
+        return VG_LITE_OUT_OF_MEMORY;
+
+    case Result::NonSupport:
+        return VG_LITE_NOT_SUPPORT;
+
+    default:
+        break;
+    }
+
+    return VG_LITE_TIMEOUT;
+}
+
+static Matrix matrix_conv(const vg_lite_matrix_t* matrix)
+{
+    return *(Matrix*)matrix;
+}
+
+static FillRule fill_rule_conv(vg_lite_fill_t fill)
+{
+    if (fill == VG_LITE_FILL_EVEN_ODD) {
+        return FillRule::EvenOdd;
+    }
+
+    return FillRule::Winding;
+}
+
+static BlendMethod blend_method_conv(vg_lite_blend_t blend)
+{
+    switch (blend) {
+    case VG_LITE_BLEND_NONE:
+        return BlendMethod::SrcOver;
+
+    case VG_LITE_BLEND_NORMAL_LVGL:
+        return BlendMethod::Normal;
+
+    case VG_LITE_BLEND_SRC_OVER:
+        return BlendMethod::Normal;
+
+    case VG_LITE_BLEND_SCREEN:
+        return BlendMethod::Screen;
+
+    case VG_LITE_BLEND_ADDITIVE:
+        return BlendMethod::Add;
+
+    case VG_LITE_BLEND_MULTIPLY:
+        return BlendMethod::Multiply;
+
+    default:
+        break;
+    }
+
+    return BlendMethod::Normal;
+}
+
+static float vlc_get_arg(const void* data, vg_lite_format_t format)
+{
+    switch (format) {
+    case VG_LITE_S8:
+        return *((int8_t*)data);
+
+    case VG_LITE_S16:
+        return *((int16_t*)data);
+
+    case VG_LITE_S32:
+        return *((int32_t*)data);
+
+    case VG_LITE_FP32:
+        return *((float*)data);
+
+    default:
+        TVG_LOG("UNKNOW_FORMAT: %d\n", format);
+        break;
+    }
+
+    return 0;
+}
+
+static uint8_t vlc_format_len(vg_lite_format_t format)
+{
     switch (format) {
     case VG_LITE_S8:
         return 1;
@@ -1852,337 +3958,2772 @@ static uint8_t vlc_format_len(vg_lite_format_t format)
     case VG_LITE_FP32:
         return 4;
     default:
-        TVG_LOG("UNKNOW_FORMAT: %d\n", format);
+        TVG_LOG("UNKNOW_FORMAT: %d\n", format);
+        TVG_ASSERT(false);
+        break;
+    }
+
+    return 0;
+}
+
+static uint8_t vlc_op_arg_len(uint8_t vlc_op)
+{
+    switch (vlc_op) {
+        VLC_OP_ARG_LEN(END, 0);
+        VLC_OP_ARG_LEN(CLOSE, 0);
+        VLC_OP_ARG_LEN(MOVE, 2);
+        VLC_OP_ARG_LEN(MOVE_REL, 2);
+        VLC_OP_ARG_LEN(LINE, 2);
+        VLC_OP_ARG_LEN(LINE_REL, 2);
+        VLC_OP_ARG_LEN(QUAD, 4);
+        VLC_OP_ARG_LEN(QUAD_REL, 4);
+        VLC_OP_ARG_LEN(CUBIC, 6);
+        VLC_OP_ARG_LEN(CUBIC_REL, 6);
+        VLC_OP_ARG_LEN(SCCWARC, 5);
+        VLC_OP_ARG_LEN(SCCWARC_REL, 5);
+        VLC_OP_ARG_LEN(SCWARC, 5);
+        VLC_OP_ARG_LEN(SCWARC_REL, 5);
+        VLC_OP_ARG_LEN(LCCWARC, 5);
+        VLC_OP_ARG_LEN(LCCWARC_REL, 5);
+        VLC_OP_ARG_LEN(LCWARC, 5);
+        VLC_OP_ARG_LEN(LCWARC_REL, 5);
+    default:
+        TVG_LOG("UNKNOW_VLC_OP: 0x%x", vlc_op);
+        TVG_ASSERT(false);
+        break;
+    }
+
+    return 0;
+}
+
+static void path_raster_init(path_raster_t* raster, vg_lite_quality_t quality, const vg_lite_matrix_t* matrix)
+{
+    raster->matrix = matrix;
+    raster->matrix_type = vg_lite_tvg_matrix_classify(matrix);
+
+    /* approximate device pixel size of one path unit */
+    float sx = sqrtf(matrix->m[0][0] * matrix->m[0][0] + matrix->m[1][0] * matrix->m[1][0]);
+    float sy = sqrtf(matrix->m[0][1] * matrix->m[0][1] + matrix->m[1][1] * matrix->m[1][1]);
+    raster->scale = MAX(sx, sy);
+
+    switch (quality) {
+    case VG_LITE_LOW:
+        raster->tolerance = PATH_FLATTEN_TOLERANCE_LOW;
+        break;
+    case VG_LITE_MEDIUM:
+        raster->tolerance = PATH_FLATTEN_TOLERANCE_MEDIUM;
+        break;
+    case VG_LITE_UPPER:
+        raster->tolerance = PATH_FLATTEN_TOLERANCE_UPPER;
+        break;
+    default:
+        /* keep the curves, ThorVG flattens them with full precision */
+        raster->tolerance = 0;
+        break;
+    }
+
+    /* Pixel snapping is only exact for scale + translate matrices,
+     * snapped axis-aligned edges then cover whole pixels and are filled
+     * without any anti-aliasing coverage.
+     */
+    raster->snap = quality == VG_LITE_LOW
+        && raster->matrix_type <= VG_LITE_TVG_MATRIX_SCALE
+        && !math_zero(matrix->m[0][0]) && !math_zero(matrix->m[1][1]);
+
+    raster->cur_x = raster->cur_y = 0;
+    raster->start_x = raster->start_y = 0;
+
+    raster->bounds[0] = raster->bounds[1] = FLT_MAX;
+    raster->bounds[2] = raster->bounds[3] = -FLT_MAX;
+
+    raster->cmds.clear();
+    raster->pts.clear();
+    raster->cmd_data = nullptr;
+    raster->cmd_count = 0;
+    raster->pt_data = nullptr;
+    raster->pt_count = 0;
+}
+
+static inline float path_raster_snap(float v, float scale, float offset)
+{
+    return (floorf(v * scale + offset + 0.5f) - offset) / scale;
+}
+
+static void path_raster_add_point(path_raster_t* raster, float x, float y)
+{
+    raster->bounds[0] = MIN(raster->bounds[0], x);
+    raster->bounds[1] = MIN(raster->bounds[1], y);
+    raster->bounds[2] = MAX(raster->bounds[2], x);
+    raster->bounds[3] = MAX(raster->bounds[3], y);
+    raster->pts.push_back({ x, y });
+}
+
+static void path_raster_add_vertex(path_raster_t* raster, PathCommand cmd, float x, float y)
+{
+    raster->cur_x = x;
+    raster->cur_y = y;
+
+    if (raster->snap) {
+        x = path_raster_snap(x, raster->matrix->m[0][0], raster->matrix->m[0][2]);
+        y = path_raster_snap(y, raster->matrix->m[1][1], raster->matrix->m[1][2]);
+    }
+
+    raster->cmds.push_back(cmd);
+    path_raster_add_point(raster, x, y);
+}
+
+static void path_raster_move_to(path_raster_t* raster, float x, float y)
+{
+    raster->start_x = x;
+    raster->start_y = y;
+    path_raster_add_vertex(raster, PathCommand::MoveTo, x, y);
+}
+
+static void path_raster_line_to(path_raster_t* raster, float x, float y)
+{
+    path_raster_add_vertex(raster, PathCommand::LineTo, x, y);
+}
+
+static void path_raster_cubic_to(path_raster_t* raster,
+    float cx1, float cy1, float cx2, float cy2, float x, float y)
+{
+    float x0 = raster->cur_x;
+    float y0 = raster->cur_y;
+
+    if (raster->tolerance <= 0) {
+        raster->cur_x = x;
+        raster->cur_y = y;
+        raster->cmds.push_back(PathCommand::CubicTo);
+        path_raster_add_point(raster, cx1, cy1);
+        path_raster_add_point(raster, cx2, cy2);
+        path_raster_add_point(raster, x, y);
+        return;
+    }
+
+    /* Wang's formula: segment count for a flattening error below tolerance. */
+    float ddx0 = x0 - 2 * cx1 + cx2;
+    float ddy0 = y0 - 2 * cy1 + cy2;
+    float ddx1 = cx1 - 2 * cx2 + x;
+    float ddy1 = cy1 - 2 * cy2 + y;
+    float dd = sqrtf(MAX(ddx0 * ddx0 + ddy0 * ddy0, ddx1 * ddx1 + ddy1 * ddy1)) * raster->scale;
+    int32_t n = (int32_t)ceilf(sqrtf(0.75f * dd / raster->tolerance));
+    n = CLAMP(n, 1, PATH_FLATTEN_MAX_SEGMENTS);
+
+    for (int32_t i = 1; i < n; i++) {
+        float t = (float)i / n;
+        float mt = 1.0f - t;
+        float a = mt * mt * mt;
+        float b = 3 * mt * mt * t;
+        float c = 3 * mt * t * t;
+        float d = t * t * t;
+        path_raster_line_to(raster,
+            a * x0 + b * cx1 + c * cx2 + d * x,
+            a * y0 + b * cy1 + c * cy2 + d * y);
+    }
+
+    path_raster_line_to(raster, x, y);
+}
+
+static void path_raster_quad_to(path_raster_t* raster, float cx, float cy, float x, float y)
+{
+    float x0 = raster->cur_x;
+    float y0 = raster->cur_y;
+
+    if (raster->tolerance <= 0) {
+        /* elevate to a cubic */
+        path_raster_cubic_to(raster,
+            x0 + (cx - x0) * 2 / 3, y0 + (cy - y0) * 2 / 3,
+            x + (cx - x) * 2 / 3, y + (cy - y) * 2 / 3,
+            x, y);
+        return;
+    }
+
+    float ddx = x0 - 2 * cx + x;
+    float ddy = y0 - 2 * cy + y;
+    float dd = sqrtf(ddx * ddx + ddy * ddy) * raster->scale;
+    int32_t n = (int32_t)ceilf(sqrtf(0.25f * dd / raster->tolerance));
+    n = CLAMP(n, 1, PATH_FLATTEN_MAX_SEGMENTS);
+
+    for (int32_t i = 1; i < n; i++) {
+        float t = (float)i / n;
+        float mt = 1.0f - t;
+        float a = mt * mt;
+        float b = 2 * mt * t;
+        float c = t * t;
+        path_raster_line_to(raster,
+            a * x0 + b * cx + c * x,
+            a * y0 + b * cy + c * y);
+    }
+
+    path_raster_line_to(raster, x, y);
+}
+
+static void path_raster_close(path_raster_t* raster)
+{
+    raster->cur_x = raster->start_x;
+    raster->cur_y = raster->start_y;
+    raster->cmds.push_back(PathCommand::Close);
+}
+
+static void path_raster_load_compiled(path_raster_t* raster, const vg_lite_path_t* path)
+{
+    const uint8_t* base = (const uint8_t*)path->uploaded.handle;
+    auto entry = (const vg_lite_tvg_path_pack_entry_t*)path->uploaded.memory;
+    const uint8_t* cmds = base + entry->cmd_offset;
+
+    /* validated by vg_lite_tvg_path_pack_open(), nothing to parse */
+    memcpy(raster->bounds, entry->bounds, sizeof(raster->bounds));
+    raster->pt_data = (const Point*)(base + entry->pt_offset);
+    raster->pt_count = entry->pt_count;
+    raster->cmd_count = entry->cmd_count;
+
+    if (sizeof(PathCommand) == sizeof(uint8_t)) {
+        raster->cmd_data = (const PathCommand*)cmds;
+        return;
+    }
+
+    /* ThorVG builds with a wider PathCommand need the commands widened */
+    raster->cmds.resize(entry->cmd_count);
+    for (uint32_t i = 0; i < entry->cmd_count; i++) {
+        raster->cmds[i] = (PathCommand)cmds[i];
+    }
+    raster->cmd_data = raster->cmds.data();
+}
+
+static void path_raster_parse(path_raster_t* raster, const vg_lite_path_t* path, const vg_lite_matrix_t* matrix)
+{
+    uint8_t fmt_len = vlc_format_len(path->format);
+    uint8_t* cur = (uint8_t*)path->path;
+    uint8_t* end = cur + path->path_length;
+
+    path_raster_init(raster, path->quality, matrix);
+
+    if (path_is_compiled(path)) {
+        path_raster_load_compiled(raster, path);
+        return;
+    }
+
+    while (cur < end) {
+        /* get op code */
+        uint8_t op_code = VLC_GET_OP_CODE(cur);
+
+        /* get arguments length */
+        uint8_t arg_len = vlc_op_arg_len(op_code);
+
+        /* skip op code */
+        cur += fmt_len;
+
+        switch (op_code) {
+        case VLC_OP_MOVE: {
+            float x = VLC_GET_ARG(cur, 0);
+            float y = VLC_GET_ARG(cur, 1);
+            path_raster_move_to(raster, x, y);
+        } break;
+
+        case VLC_OP_LINE: {
+            float x = VLC_GET_ARG(cur, 0);
+            float y = VLC_GET_ARG(cur, 1);
+            path_raster_line_to(raster, x, y);
+        } break;
+
+        case VLC_OP_QUAD: {
+            float cx = VLC_GET_ARG(cur, 0);
+            float cy = VLC_GET_ARG(cur, 1);
+            float x = VLC_GET_ARG(cur, 2);
+            float y = VLC_GET_ARG(cur, 3);
+            path_raster_quad_to(raster, cx, cy, x, y);
+        } break;
+
+        case VLC_OP_CUBIC: {
+            float cx1 = VLC_GET_ARG(cur, 0);
+            float cy1 = VLC_GET_ARG(cur, 1);
+            float cx2 = VLC_GET_ARG(cur, 2);
+            float cy2 = VLC_GET_ARG(cur, 3);
+            float x = VLC_GET_ARG(cur, 4);
+            float y = VLC_GET_ARG(cur, 5);
+            path_raster_cubic_to(raster, cx1, cy1, cx2, cy2, x, y);
+        } break;
+
+        case VLC_OP_CLOSE:
+        case VLC_OP_END: {
+            path_raster_close(raster);
+        } break;
+
+        default:
+            break;
+        }
+
+        cur += arg_len * fmt_len;
+    }
+
+    raster->cmd_data = raster->cmds.data();
+    raster->cmd_count = raster->cmds.size();
+    raster->pt_data = raster->pts.data();
+    raster->pt_count = raster->pts.size();
+}
+
+/* The hardware clips a path to its bounding box, this is only visible when
+ * the path actually leaves the box. */
+static bool path_raster_need_clip(const path_raster_t* raster, const vg_lite_path_t* path)
+{
+    float x_min = path->bounding_box[0];
+    float y_min = path->bounding_box[1];
+    float x_max = path->bounding_box[2];
+    float y_max = path->bounding_box[3];
+
+    if (math_equal(x_min, __FLT_MIN__) && math_equal(y_min, __FLT_MIN__)
+        && math_equal(x_max, __FLT_MAX__) && math_equal(y_max, __FLT_MAX__)) {
+        return false;
+    }
+
+    return raster->bounds[0] < x_min || raster->bounds[1] < y_min
+        || raster->bounds[2] > x_max || raster->bounds[3] > y_max;
+}
+
+/* Device pixel bounds of the parsed path, false if they can't be computed. */
+static bool path_raster_device_bounds(const path_raster_t* raster, int32_t bounds[4])
+{
+    if (!raster->pt_count) {
+        return false;
+    }
+
+    return device_bounds(raster->matrix, raster->matrix_type, raster->bounds, bounds);
+}
+
+/* Device pixels touched by (rect): left, top, right, bottom, mapped by an affine (matrix). */
+static bool device_bounds(const vg_lite_matrix_t* m, vg_lite_tvg_matrix_type_t type, const float rect[4], int32_t bounds[4])
+{
+    if (type == VG_LITE_TVG_MATRIX_PERSPECTIVE) {
+        return false;
+    }
+
+    float x_min = FLT_MAX, y_min = FLT_MAX;
+    float x_max = -FLT_MAX, y_max = -FLT_MAX;
+
+    if (type <= VG_LITE_TVG_MATRIX_TRANSLATE) {
+        x_min = rect[0] + m->m[0][2];
+        y_min = rect[1] + m->m[1][2];
+        x_max = rect[2] + m->m[0][2];
+        y_max = rect[3] + m->m[1][2];
+    } else {
+        /* two opposite corners are enough while the axes stay aligned */
+        int corners = type == VG_LITE_TVG_MATRIX_SCALE ? 2 : 4;
+
+        for (int i = 0; i < corners; i++) {
+            float x = rect[(i == 1 || i == 2) ? 2 : 0];
+            float y = rect[(i == 1 || i == 3) ? 3 : 1];
+            float dx = m->m[0][0] * x + m->m[0][1] * y + m->m[0][2];
+            float dy = m->m[1][0] * x + m->m[1][1] * y + m->m[1][2];
+            x_min = MIN(x_min, dx);
+            y_min = MIN(y_min, dy);
+            x_max = MAX(x_max, dx);
+            y_max = MAX(y_max, dy);
+        }
+    }
+
+    /* anti-aliasing touches every pixel the edges pass through */
+    bounds[0] = (int32_t)floorf(x_min);
+    bounds[1] = (int32_t)floorf(y_min);
+    bounds[2] = (int32_t)ceilf(x_max);
+    bounds[3] = (int32_t)ceilf(y_max);
+    return true;
+}
+
+/* Whether a paint covering (bounds) can touch the target, and whether it
+ * has to be clipped to the scissor. Culled paints are counted here.
+ */
+static bool draw_visible(vg_lite_ctx* ctx, const int32_t bounds[4], bool* clip)
+{
+    if (bounds[2] <= 0 || bounds[3] <= 0
+        || bounds[0] >= (int32_t)ctx->canvas_width || bounds[1] >= (int32_t)ctx->canvas_height
+        || !ctx->scissor_test(bounds, clip)) {
+        ctx->stats.draw_culled++;
+        return false;
+    }
+
+    return true;
+}
+
+static Result shape_append_raster(Shape* shape, const path_raster_t* raster, const vg_lite_path_t* path)
+{
+    if (raster->cmd_count) {
+        TVG_CHECK_RETURN_RESULT(shape->appendPath(raster->cmd_data, raster->cmd_count, raster->pt_data, raster->pt_count));
+    }
+
+    if (!path_raster_need_clip(raster, path)) {
+        return Result::Success;
+    }
+
+    float x_min = path->bounding_box[0];
+    float y_min = path->bounding_box[1];
+    float x_max = path->bounding_box[2];
+    float y_max = path->bounding_box[3];
+
+    auto cilp = Shape::gen();
+    TVG_CHECK_RETURN_RESULT(cilp->appendRect(x_min, y_min, x_max - x_min, y_max - y_min, 0, 0));
+    TVG_CHECK_RETURN_RESULT(cilp->transform(matrix_conv(raster->matrix)));
+    TVG_CHECK_RETURN_RESULT(shape->composite(std::move(cilp), CompositeMethod::ClipPath));
+
+    return Result::Success;
+}
+
+/* Append (rect), or the whole canvas of the current target without one. */
+static Result shape_append_rect(vg_lite_ctx* ctx, std::unique_ptr<Shape>& shape, const vg_lite_rectangle_t* rect)
+{
+    if (rect) {
+        TVG_CHECK_RETURN_RESULT(shape->appendRect(rect->x, rect->y, rect->width, rect->height, 0, 0));
+    } else {
+        TVG_CHECK_RETURN_RESULT(shape->appendRect(0, 0, ctx->canvas_width, ctx->canvas_height, 0, 0));
+    }
+
+    return Result::Success;
+}
+
+/* Fill the path with a paint server and push it. */
+static Result shape_push_fill(vg_lite_ctx* ctx, const vg_lite_buffer_t* target, vg_lite_path_t* path, vg_lite_fill_t fill_rule,
+    vg_lite_matrix_t* matrix, vg_lite_blend_t blend, std::unique_ptr<Fill> fill)
+{
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, matrix);
+
+    int32_t bounds[4];
+    bool clip = true;
+    if (path_raster_device_bounds(raster, bounds) && !draw_visible(ctx, bounds, &clip)) {
+        return Result::Success;
+    }
+
+    auto shape = Shape::gen();
+    TVG_CHECK_RETURN_RESULT(shape_append_raster(shape.get(), raster, path));
+    TVG_CHECK_RETURN_RESULT(shape->transform(matrix_conv(matrix)));
+    TVG_CHECK_RETURN_RESULT(shape->fill(fill_rule_conv(fill_rule)));
+    TVG_CHECK_RETURN_RESULT(shape->blend(blend_method_conv(blend)));
+    TVG_CHECK_RETURN_RESULT(shape->fill(std::move(fill)));
+    return ctx->push(std::move(shape), clip);
+}
+
+Result vg_lite_ctx::push(std::unique_ptr<Paint> paint, bool clip)
+{
+    batch_end();
+
+    /* A paint takes one composite, the ones it already has are kept by
+     * wrapping it in a scene.
+     */
+    const Paint* target = nullptr;
+
+    if (mask_enabled && mask.memory) {
+        if (!mask_image) {
+            uint32_t* image = get_canvas_image(mask.width, mask.height);
+            for (int32_t y = 0; y < mask.height; y++) {
+                mask_expand_span(image + y * mask.width, (const uint8_t*)mask.memory + y * mask.stride, mask.width);
+            }
+            mask_image = image;
+        }
+
+        auto picture = Picture::gen();
+        TVG_CHECK_RETURN_RESULT(picture->load((uint32_t*)mask_image, mask.width, mask.height, true));
+
+        if (paint->composite(&target) != CompositeMethod::None) {
+            auto scene = Scene::gen();
+            TVG_CHECK_RETURN_RESULT(scene->push(std::move(paint)));
+            paint = std::move(scene);
+        }
+
+        TVG_CHECK_RETURN_RESULT(paint->composite(std::move(picture), CompositeMethod::AlphaMask));
+    }
+
+    if (clip && scissor_enabled) {
+        auto clipper = Shape::gen();
+        for (auto& rect : scissor) {
+            TVG_CHECK_RETURN_RESULT(clipper->appendRect(rect.x, rect.y, rect.width, rect.height, 0, 0));
+        }
+
+        if (paint->composite(&target) != CompositeMethod::None) {
+            auto scene = Scene::gen();
+            TVG_CHECK_RETURN_RESULT(scene->push(std::move(paint)));
+            paint = std::move(scene);
+        }
+
+        /* ThorVG turns a single rectangle clip into a viewport */
+        TVG_CHECK_RETURN_RESULT(paint->composite(std::move(clipper), CompositeMethod::ClipPath));
+    }
+
+    /* the resolve and the destination alpha only touch what was drawn, a
+     * pixel around the bounds is kept for anti-aliasing
+     */
+    int32_t bounds[4] = { 0, 0, (int32_t)canvas_width, (int32_t)canvas_height };
+    float x, y, w, h;
+    if (paint->bounds(&x, &y, &w, &h, true) == Result::Success) {
+        /* compared as floats, far away paths don't fit in an int */
+        float x0 = floorf(x) - 1, y0 = floorf(y) - 1;
+        float x1 = ceilf(x + w) + 1, y1 = ceilf(y + h) + 1;
+        if (x0 > bounds[0]) {
+            bounds[0] = x0 < bounds[2] ? (int32_t)x0 : bounds[2];
+        }
+        if (y0 > bounds[1]) {
+            bounds[1] = y0 < bounds[3] ? (int32_t)y0 : bounds[3];
+        }
+        if (x1 < bounds[2]) {
+            bounds[2] = x1 > 0 ? (int32_t)x1 : 0;
+        }
+        if (y1 < bounds[3]) {
+            bounds[3] = y1 > 0 ? (int32_t)y1 : 0;
+        }
+    }
+    if (clip) {
+        scissor_bounds(bounds);
+    }
+    if (bounds[0] < bounds[2] && bounds[1] < bounds[3]) {
+        if (drawn[0] >= drawn[2] || drawn[1] >= drawn[3]) {
+            memcpy(drawn, bounds, sizeof(drawn));
+        } else {
+            drawn[0] = MIN(drawn[0], bounds[0]);
+            drawn[1] = MIN(drawn[1], bounds[1]);
+            drawn[2] = MAX(drawn[2], bounds[2]);
+            drawn[3] = MAX(drawn[3], bounds[3]);
+        }
+    }
+
+    return canvas->push(std::move(paint));
+}
+
+static Result canvas_set_target(vg_lite_ctx* ctx, vg_lite_buffer_t* target)
+{
+    uint32_t* target_buffer = nullptr;
+
+    /* if target_buffer needs to be changed, finish current drawing */
+    if ((ctx->target_buffer && ctx->target_buffer != target->memory)
+        || (ctx->direct_buffer && ctx->direct_buffer != target->memory)) {
+        vg_lite_finish();
+    }
+
+    /* a pending batch is drawn into the target it was merged for */
+    if (ctx->batch_target() && ctx->batch_target() != target->memory) {
+        TVG_CHECK_RETURN_RESULT(ctx->batch_end());
+    }
+
+    ctx->target_format = target->format;
+
+    /* paints are drawn in the canvas orientation, quarter turns swap its sides */
+    bool swap = ctx->rotation == VG_LITE_TVG_ROTATION_90 || ctx->rotation == VG_LITE_TVG_ROTATION_270;
+    ctx->canvas_width = swap ? target->height : target->width;
+    ctx->canvas_height = swap ? target->width : target->height;
+
+    /* ThorVG takes no negative stride, mirrored and rotated targets are turned by the resolve instead */
+    if (TVG_IS_VG_FMT_SUPPORT(target->format) && ctx->orientation == VG_LITE_ORIENTATION_TOP_BOTTOM
+        && ctx->rotation == VG_LITE_TVG_ROTATION_0 && !ctx->linear_blend) {
+        /* if target format is supported by VG, use target buffer directly */
+        target_buffer = (uint32_t*)target->memory;
+        ctx->target_buffer = nullptr;
+        ctx->direct_buffer = target_buffer;
+        ctx->target_px_size = target->width * target->height;
+        ctx->target_width = target->width;
+        ctx->target_stride = target->stride / sizeof(uint32_t);
+    } else {
+        /* if target format is not supported by VG, use internal buffer */
+        target_buffer = ctx->get_temp_target_buffer(target->width, target->height);
+        ctx->target_buffer = target->memory;
+        ctx->direct_buffer = nullptr;
+        ctx->target_px_size = target->width * target->height;
+        ctx->target_width = target->width;
+        ctx->target_stride = ctx->canvas_width;
+        ctx->target_buffer_stride = target->stride;
+    }
+
+    /* ThorVG blends premultiplied, straight targets drawn in place are converted around it */
+    bool straight = ctx->direct_buffer && !ctx->dst_premultiplied;
+    Result res = ctx->canvas->target(
+        target_buffer,
+        ctx->target_stride,
+        ctx->canvas_width,
+        ctx->canvas_height,
+        straight ? SwCanvas::ARGB8888S : SwCanvas::ARGB8888);
+
+    return res;
+}
+
+static uint32_t width_to_stride(uint32_t w, vg_lite_buffer_format_t color_format)
+{
+    if (vg_lite_query_feature(gcFEATURE_BIT_VG_16PIXELS_ALIGN)) {
+        w = VG_LITE_ALIGN(w, 16);
+    }
+
+    uint32_t mul, div, align;
+    get_format_bytes(color_format, &mul, &div, &align);
+    return VG_LITE_ALIGN((w * mul / div), align);
+}
+
+static bool decode_indexed_line(
+    vg_lite_buffer_format_t color_format,
+    const uint32_t* palette,
+    int32_t x, int32_t y,
+    int32_t w_px, const uint8_t* in, uint32_t* out)
+{
+    uint8_t px_size;
+    uint16_t mask;
+
+    uint32_t w_byte = width_to_stride(w_px, color_format);
+
+    in += w_byte * y; /*First pixel*/
+    out += w_px * y;
+
+    int8_t shift = 0;
+    switch (color_format) {
+    case VG_LITE_INDEX_1:
+        px_size = 1;
+        in += x / 8; /*8pixel per byte*/
+        shift = 7 - (x & 0x7);
+        break;
+    case VG_LITE_INDEX_2:
+        px_size = 2;
+        in += x / 4; /*4pixel per byte*/
+        shift = 6 - 2 * (x & 0x3);
+        break;
+    case VG_LITE_INDEX_4:
+        px_size = 4;
+        in += x / 2; /*2pixel per byte*/
+        shift = 4 - 4 * (x & 0x1);
+        break;
+    case VG_LITE_INDEX_8:
+        px_size = 8;
+        in += x;
+        shift = 0;
+        break;
+    default:
         TVG_ASSERT(false);
-        break;
+        return false;
+    }
+
+    mask = (1 << px_size) - 1; /*E.g. px_size = 2; mask = 0x03*/
+
+    int32_t i;
+    for (i = 0; i < w_px; i++) {
+        uint8_t val_act = (*in >> shift) & mask;
+        out[i] = palette[val_act];
+
+        shift -= px_size;
+        if (shift < 0) {
+            shift = 8 - px_size;
+            in++;
+        }
+    }
+    return true;
+}
+
+/* If (ops) change the decoded pixels at all. */
+static inline bool picture_line_ops_any(const picture_line_ops_t* ops)
+{
+    return ops->premultiply || ops->color_key || ops->gamma || ops->pixel_matrix || ops->color_transform
+        || ops->global_alpha;
+}
+
+/* Copy (count) decoded pixels through the color key, the premultiply, the
+ * gamma, the pixel matrix, the color transform and the global alpha, (dst)
+ * may be (src).
+ */
+static void picture_decode_line(uint32_t* dst, const uint32_t* src, uint32_t count, const picture_line_ops_t* ops)
+{
+    const uint8_t* gamma = ops->gamma;
+    if (ops->color_key) {
+        /* the keys test straight colors, only the pixels they miss are premultiplied */
+        color_key_span(dst, src, count, ops->color_key, ops->premultiply);
+    } else if (ops->premultiply) {
+        /* straight colors take the gamma on the way */
+        picture_premultiply_span(dst, src, count, gamma);
+        gamma = nullptr;
+    } else if (dst != src) {
+        memcpy(dst, src, count * sizeof(uint32_t));
+    }
+
+    if (gamma) {
+        picture_gamma_span(dst, dst, count, gamma);
+    }
+
+    if (ops->pixel_matrix) {
+        pixel_matrix_span(dst, count, ops->pixel_matrix);
+    }
+
+    if (ops->color_transform) {
+        pixel_matrix_span(dst, count, ops->color_transform);
+    }
+
+    if (ops->global_alpha) {
+        picture_global_alpha_span(dst, count, *ops->global_alpha);
+    }
+}
+
+/* Hash of the (source) pixels and of all state picture_decode() applies to them. */
+static uint64_t picture_decode_key(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color, const picture_line_ops_t* ops)
+{
+    uint64_t key = picture_hash(source->memory, source->stride * source->height, 0);
+    key = picture_hash(&source->format, sizeof(source->format), key);
+    key = picture_hash(&source->image_mode, sizeof(source->image_mode), key);
+    key = picture_hash(&color, sizeof(color), key);
+    key = picture_hash(&ops->premultiply, sizeof(ops->premultiply), key);
+
+    if (ops->color_key) {
+        key = picture_hash(ops->color_key, sizeof(vg_lite_color_key4_t), key);
+    }
+
+    if (ops->gamma) {
+        key = picture_hash(ops->gamma, 256, key);
+    }
+
+    if (ops->global_alpha) {
+        key = picture_hash(ops->global_alpha, sizeof(uint8_t), key);
+    }
+
+    /* field by field, the padding is not hashed */
+    const pixel_matrix_t* matrices[2] = { ops->pixel_matrix, ops->color_transform };
+    for (int i = 0; i < 2; i++) {
+        const pixel_matrix_t* matrix = matrices[i];
+        uint8_t present = matrix != nullptr;
+        key = picture_hash(&present, sizeof(present), key);
+        if (matrix) {
+            key = picture_hash(matrix->m, sizeof(matrix->m), key);
+            key = picture_hash(matrix->enable, sizeof(matrix->enable), key);
+            key = picture_hash(&matrix->premultiplied, sizeof(matrix->premultiplied), key);
+        }
+    }
+
+    if (IS_INDEX_FMT(source->format)) {
+        uint32_t count = source->format == VG_LITE_INDEX_8 ? 256 : source->format == VG_LITE_INDEX_4 ? 4 : 2;
+        key = picture_hash(ctx->get_CLUT(source->format), count * sizeof(uint32_t), key);
+    }
+
+    return key;
+}
+
+/* True if the pixels of (format) carry their own alpha, alpha only formats take
+ * the paint color and are premultiplied by their converters.
+ */
+static bool picture_has_alpha(vg_lite_buffer_format_t format)
+{
+    return format == VG_LITE_BGRA8888 || format == VG_LITE_BGRA5658 || IS_INDEX_FMT(format);
+}
+
+/* The line ops picture_decode() applies to (source) in the current state. */
+static void picture_line_ops_init(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, picture_line_ops_t* ops)
+{
+    /* the color key tests the source RGB, which alpha formats have not */
+    ops->premultiply = !ctx->src_premultiplied && picture_has_alpha(source->format);
+    ops->color_key = VG_LITE_IS_ALPHA_FORMAT(source->format) ? nullptr : ctx->get_color_key();
+    ops->gamma = ctx->get_image_gamma();
+    ops->pixel_matrix = ctx->get_pixel_matrix();
+    ops->color_transform = ctx->get_color_transform();
+    ops->global_alpha = ctx->get_source_global_alpha();
+}
+
+static uint32_t* picture_decode(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color)
+{
+    uint32_t* image_buffer;
+    TVG_ASSERT(VG_LITE_IS_ALIGNED(source->memory, CONFIG_VG_LITE_TVG_BUF_ADDR_ALIGN));
+
+#ifdef CONFIG_VG_LITE_TVG_16PIXELS_ALIGN
+    TVG_ASSERT(VG_LITE_IS_ALIGNED(source->width, 16));
+#endif
+
+    picture_line_ops_t line_ops;
+    picture_line_ops_init(ctx, source, &line_ops);
+    const picture_line_ops_t* ops = picture_line_ops_any(&line_ops) ? &line_ops : nullptr;
+
+    if (source->format == VG_LITE_BGRA8888 && source->image_mode == VG_LITE_NORMAL_IMAGE_MODE && !ops) {
+        image_buffer = (uint32_t*)source->memory;
+    } else {
+        uint32_t width = source->width;
+        uint32_t height = source->height;
+        uint32_t px_size = width * height;
+
+        /* the line ops cost more than hashing, so their results are kept */
+        if (ops && source->format != VG_LITE_NV12) {
+            uint64_t key = picture_decode_key(ctx, source, color, &line_ops);
+            image_buffer = ctx->find_picture_cache(PICTURE_CACHE_DECODE, source->memory, width, height, key);
+            if (image_buffer) {
+                ctx->stats.image_cache_hit++;
+                return image_buffer;
+            }
+
+            ctx->stats.image_cache_miss++;
+            image_buffer = ctx->add_picture_cache(PICTURE_CACHE_DECODE, source->memory, width, height, key);
+        } else {
+            image_buffer = ctx->get_image_buffer(width, height);
+        }
+
+        vg_lite_buffer_t target;
+        memset(&target, 0, sizeof(target));
+        target.memory = image_buffer;
+        target.format = VG_LITE_BGRA8888;
+        target.width = width;
+        target.height = height;
+        target.stride = width_to_stride(width, target.format);
+
+        switch (source->format) {
+        case VG_LITE_INDEX_1:
+        case VG_LITE_INDEX_2:
+        case VG_LITE_INDEX_4:
+        case VG_LITE_INDEX_8: {
+            const uint32_t* clut_colors = ctx->get_CLUT(source->format);
+            for (uint32_t y = 0; y < height; y++) {
+                decode_indexed_line(source->format, clut_colors, 0, y, width, (uint8_t*)source->memory, image_buffer);
+                if (ops) {
+                    uint32_t* line = image_buffer + y * width;
+                    picture_decode_line(line, line, width, ops);
+                }
+            }
+        } break;
+
+        case VG_LITE_A4: {
+            conv_alpha4_to_bgra8888.convert(&target, source, color, ops);
+        } break;
+
+        case VG_LITE_A8: {
+            conv_alpha8_to_bgra8888.convert(&target, source, color, ops);
+        } break;
+
+        case VG_LITE_BGRX8888: {
+            conv_bgrx8888_to_bgra8888.convert(&target, source, 0, ops);
+        } break;
+
+        case VG_LITE_BGR888: {
+            conv_bgr888_to_bgra8888.convert(&target, source, 0, ops);
+        } break;
+
+        case VG_LITE_BGRA5658: {
+            conv_bgra5658_to_bgra8888.convert(&target, source, 0, ops);
+        } break;
+
+        case VG_LITE_BGR565: {
+            conv_bgr565_to_bgra8888.convert(&target, source, 0, ops);
+        } break;
+
+#ifdef CONFIG_VG_LITE_TVG_YUV_SUPPORT
+        case VG_LITE_NV12: {
+            libyuv::NV12ToARGB((const uint8_t*)source->memory, source->stride, (const uint8_t*)source->yuv.uv_memory, source->yuv.uv_stride,
+                (uint8_t*)image_buffer, source->width * sizeof(uint32_t), width, height);
+            if (ops) {
+                picture_decode_line(image_buffer, image_buffer, px_size, ops);
+            }
+        } break;
+#endif
+
+        case VG_LITE_BGRA8888: {
+            if (ops) {
+                /* applied while copying */
+                for (uint32_t y = 0; y < height; y++) {
+                    picture_decode_line(image_buffer + y * width,
+                        (const uint32_t*)((const uint8_t*)source->memory + y * source->stride), width, ops);
+                }
+            } else {
+                memcpy(image_buffer, source->memory, px_size * sizeof(vg_color32_t));
+            }
+        } break;
+
+        default:
+            TVG_LOG("unsupport format: %d\n", source->format);
+            TVG_ASSERT(false);
+            break;
+        }
+
+        /* multiply color */
+        if (source->image_mode == VG_LITE_MULTIPLY_IMAGE_MODE && !VG_LITE_IS_ALPHA_FORMAT(source->format)) {
+            vg_color32_t* dest = (vg_color32_t*)image_buffer;
+            while (px_size--) {
+                dest->alpha = UDIV255(dest->alpha * A(color));
+                dest->red = UDIV255(dest->red * B(color));
+                dest->green = UDIV255(dest->green * G(color));
+                dest->blue = UDIV255(dest->blue * R(color));
+                dest++;
+            }
+        }
+    }
+
+    return image_buffer;
+}
+
+/* 64-bit hash of (size) bytes continuing from (seed), four independent lanes. */
+static uint64_t picture_hash(const void* data, uint32_t size, uint64_t seed)
+{
+    const uint64_t prime = 0x100000001B3ULL;
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t h[4] = { 0xCBF29CE484222325ULL ^ seed, 0x84222325CBF29CE4ULL, 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL };
+    uint32_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        uint64_t words[4];
+        memcpy(words, bytes + i, sizeof(words));
+        for (int k = 0; k < 4; k++) {
+            h[k] = (h[k] ^ words[k]) * prime;
+            h[k] ^= h[k] >> 29;
+        }
+    }
+
+    for (; i < size; i++) {
+        h[0] = (h[0] ^ bytes[i]) * prime;
+        h[0] ^= h[0] >> 29;
+    }
+
+    uint64_t hash = size;
+    for (int k = 0; k < 4; k++) {
+        hash = (hash ^ h[k]) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+    }
+    return hash;
+}
+
+/* One channel at bit (shift) of the 3x3 kernel. The kernel is symmetric, so
+ * the taps sharing a weight are summed first and take one multiply each.
+ */
+static inline uint32_t picture_gauss_channel(const uint32_t* up, const uint32_t* mid, const uint32_t* down,
+    uint32_t x0, uint32_t x, uint32_t x1, uint32_t shift, const int32_t weights[3])
+{
+#define GAUSS_CH(p) (((p) >> shift) & 0xFF)
+    uint32_t side_up = GAUSS_CH(up[x0]) + GAUSS_CH(up[x1]);
+    uint32_t side_mid = GAUSS_CH(mid[x0]) + GAUSS_CH(mid[x1]);
+    uint32_t side_down = GAUSS_CH(down[x0]) + GAUSS_CH(down[x1]);
+    uint32_t v = weights[2] * (side_up + side_down)
+        + weights[1] * (GAUSS_CH(up[x]) + GAUSS_CH(down[x]) + side_mid)
+        + weights[0] * GAUSS_CH(mid[x]);
+#undef GAUSS_CH
+    return ((v + 128) >> 8) << shift;
+}
+
+/* Filter (src) by the 3x3 kernel (weights), edge pixels repeat. The weights sum
+ * to 256, so every term fits 16 bits. All nine taps are read directly, for
+ * the kernels picture_gauss_split() can't take apart.
+ */
+static void picture_gauss_blur(uint32_t* dst, const uint32_t* src, uint32_t width, uint32_t height, const int32_t weights[3])
+{
+    for (uint32_t y = 0; y < height; y++) {
+        const uint32_t* up = src + (y > 0 ? y - 1 : 0) * width;
+        const uint32_t* mid = src + y * width;
+        const uint32_t* down = src + (y + 1 < height ? y + 1 : y) * width;
+        uint32_t x = 0;
+
+        while (x < width) {
+#if defined(__SSE2__)
+            if (x > 0 && x + 5 <= width) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i w0 = _mm_set1_epi16((short)weights[0]);
+                const __m128i w1 = _mm_set1_epi16((short)weights[1]);
+                const __m128i w2 = _mm_set1_epi16((short)weights[2]);
+                const __m128i round = _mm_set1_epi16(128);
+
+                for (; x + 5 <= width; x += 4) {
+                    __m128i out[2];
+                    for (int half = 0; half < 2; half++) {
+                        __m128i side[3], center[3];
+                        const uint32_t* rows[3] = { up, mid, down };
+                        for (int r = 0; r < 3; r++) {
+                            __m128i l = _mm_loadu_si128((const __m128i*)(rows[r] + x - 1));
+                            __m128i c = _mm_loadu_si128((const __m128i*)(rows[r] + x));
+                            __m128i n = _mm_loadu_si128((const __m128i*)(rows[r] + x + 1));
+                            if (half) {
+                                l = _mm_unpackhi_epi8(l, zero);
+                                c = _mm_unpackhi_epi8(c, zero);
+                                n = _mm_unpackhi_epi8(n, zero);
+                            } else {
+                                l = _mm_unpacklo_epi8(l, zero);
+                                c = _mm_unpacklo_epi8(c, zero);
+                                n = _mm_unpacklo_epi8(n, zero);
+                            }
+                            side[r] = _mm_add_epi16(l, n);
+                            center[r] = c;
+                        }
+
+                        __m128i v = _mm_mullo_epi16(w2, _mm_add_epi16(side[0], side[2]));
+                        v = _mm_add_epi16(v, _mm_mullo_epi16(w1, _mm_add_epi16(_mm_add_epi16(center[0], center[2]), side[1])));
+                        v = _mm_add_epi16(v, _mm_mullo_epi16(w0, center[1]));
+                        out[half] = _mm_srli_epi16(_mm_add_epi16(v, round), 8);
+                    }
+                    _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(out[0], out[1]));
+                }
+
+                if (x >= width) {
+                    break;
+                }
+            }
+#endif
+
+            uint32_t x0 = x > 0 ? x - 1 : 0;
+            uint32_t x1 = x + 1 < width ? x + 1 : x;
+            dst[x] = picture_gauss_channel(up, mid, down, x0, x, x1, 0, weights)
+                | picture_gauss_channel(up, mid, down, x0, x, x1, 8, weights)
+                | picture_gauss_channel(up, mid, down, x0, x, x1, 16, weights)
+                | picture_gauss_channel(up, mid, down, x0, x, x1, 24, weights);
+            x++;
+        }
+
+        dst += width;
+    }
+}
+
+/* The 1D kernel (taps[0], taps[1], taps[0]) whose outer product is the 3x3
+ * kernel (weights), false if there is none in whole numbers. The 1D weights
+ * then sum to 16, and both passes are exact, like the direct form.
+ */
+static bool picture_gauss_split(const int32_t weights[3], int32_t taps[2])
+{
+    if (weights[1] * weights[1] != weights[0] * weights[2]) {
+        return false;
+    }
+
+    for (int32_t a = 0; a <= 8; a++) {
+        int32_t b = 16 - 2 * a;
+        if (a * a == weights[2] && a * b == weights[1] && b * b == weights[0]) {
+            taps[0] = a;
+            taps[1] = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The horizontal pass of (taps) over a row of (src), edge pixels repeat. The
+ * channels are kept apart in (dst), four 16-bit sums per pixel.
+ */
+static void picture_gauss_row(uint16_t* dst, const uint32_t* src, uint32_t width, const int32_t taps[2])
+{
+    uint32_t x = 0;
+
+    while (x < width) {
+#if defined(__SSE2__)
+        if (x > 0 && x + 5 <= width) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i a = _mm_set1_epi16((short)taps[0]);
+            const __m128i b = _mm_set1_epi16((short)taps[1]);
+
+            for (; x + 5 <= width; x += 4) {
+                __m128i l = _mm_loadu_si128((const __m128i*)(src + x - 1));
+                __m128i c = _mm_loadu_si128((const __m128i*)(src + x));
+                __m128i n = _mm_loadu_si128((const __m128i*)(src + x + 1));
+                __m128i lo = _mm_add_epi16(_mm_mullo_epi16(a, _mm_add_epi16(_mm_unpacklo_epi8(l, zero), _mm_unpacklo_epi8(n, zero))),
+                    _mm_mullo_epi16(b, _mm_unpacklo_epi8(c, zero)));
+                __m128i hi = _mm_add_epi16(_mm_mullo_epi16(a, _mm_add_epi16(_mm_unpackhi_epi8(l, zero), _mm_unpackhi_epi8(n, zero))),
+                    _mm_mullo_epi16(b, _mm_unpackhi_epi8(c, zero)));
+                _mm_storeu_si128((__m128i*)(dst + x * 4), lo);
+                _mm_storeu_si128((__m128i*)(dst + x * 4 + 8), hi);
+            }
+
+            if (x >= width) {
+                break;
+            }
+        }
+#endif
+
+        uint32_t l = src[x > 0 ? x - 1 : 0];
+        uint32_t c = src[x];
+        uint32_t n = src[x + 1 < width ? x + 1 : x];
+        for (uint32_t k = 0; k < 4; k++) {
+            uint32_t shift = k * 8;
+            dst[x * 4 + k] = (uint16_t)(taps[0] * (((l >> shift) & 0xFF) + ((n >> shift) & 0xFF)) + taps[1] * ((c >> shift) & 0xFF));
+        }
+        x++;
+    }
+}
+
+/* The vertical pass of (taps) over three rows of picture_gauss_row() sums,
+ * rounded back to (width) pixels. The sums stay below 65536.
+ */
+static void picture_gauss_column(uint32_t* dst, const uint16_t* up, const uint16_t* mid, const uint16_t* down, uint32_t width,
+    const int32_t taps[2])
+{
+    uint32_t x = 0;
+
+#if defined(__SSE2__)
+    const __m128i a = _mm_set1_epi16((short)taps[0]);
+    const __m128i b = _mm_set1_epi16((short)taps[1]);
+    const __m128i round = _mm_set1_epi16(128);
+    for (; x + 4 <= width; x += 4) {
+        __m128i out[2];
+        for (int half = 0; half < 2; half++) {
+            uint32_t i = x * 4 + half * 8;
+            __m128i u = _mm_loadu_si128((const __m128i*)(up + i));
+            __m128i m = _mm_loadu_si128((const __m128i*)(mid + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(down + i));
+            __m128i v = _mm_add_epi16(_mm_mullo_epi16(a, _mm_add_epi16(u, d)), _mm_mullo_epi16(b, m));
+            out[half] = _mm_srli_epi16(_mm_add_epi16(v, round), 8);
+        }
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(out[0], out[1]));
+    }
+#endif
+
+    for (; x < width; x++) {
+        uint32_t c = 0;
+        for (uint32_t k = 0; k < 4; k++) {
+            uint32_t i = x * 4 + k;
+            uint32_t v = taps[0] * (up[i] + down[i]) + taps[1] * mid[i];
+            c |= ((v + 128) >> 8) << (k * 8);
+        }
+        dst[x] = c;
+    }
+}
+
+/* Filter (src) by the 3x3 kernel picture_gauss_split() made (taps), a row pass
+ * and a column pass, edge pixels repeat. (rows) holds three rows of row sums,
+ * see vg_lite_ctx::get_gauss_rows(). Same result as picture_gauss_blur().
+ */
+static void picture_gauss_separable(uint32_t* dst, const uint32_t* src, uint32_t width, uint32_t height, const int32_t taps[2],
+    uint16_t* rows)
+{
+    /* row sums of source row y are kept in slot y % 3 */
+    uint32_t row_size = width * 4;
+    picture_gauss_row(rows, src, width, taps);
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint32_t next = y + 1 < height ? y + 1 : y;
+        if (next != y) {
+            picture_gauss_row(rows + (next % 3) * row_size, src + next * width, width, taps);
+        }
+
+        const uint16_t* up = rows + ((y > 0 ? y - 1 : 0) % 3) * row_size;
+        const uint16_t* mid = rows + (y % 3) * row_size;
+        const uint16_t* down = rows + (next % 3) * row_size;
+        picture_gauss_column(dst + y * width, up, mid, down, width, taps);
+    }
+}
+
+/* Decoded (source) filtered by the current Gaussian weights. The result is
+ * kept while the source pixels, the decode state and the weights stay the
+ * same, a cached result is found without decoding.
+ */
+static uint32_t* picture_gaussian(vg_lite_ctx* ctx, const vg_lite_buffer_t* source, vg_lite_color_t color)
+{
+    picture_line_ops_t line_ops;
+    picture_line_ops_init(ctx, source, &line_ops);
+    uint64_t key = picture_decode_key(ctx, source, color, &line_ops);
+    key = picture_hash(ctx->gauss_weights, sizeof(ctx->gauss_weights), key);
+
+    if (source->format == VG_LITE_NV12) {
+        /* the chroma plane is not part of the decode key */
+        key = picture_hash(source->yuv.uv_memory, source->yuv.uv_stride * (source->height / 2), key);
+    }
+
+    uint32_t* bits = ctx->find_picture_cache(PICTURE_CACHE_GAUSS, source->memory, source->width, source->height, key);
+    if (bits) {
+        ctx->stats.blur_cache_hit++;
+        return bits;
+    }
+
+    ctx->stats.blur_cache_miss++;
+    const uint32_t* decoded = picture_decode(ctx, source, color);
+    bits = ctx->add_picture_cache(PICTURE_CACHE_GAUSS, source->memory, source->width, source->height, key);
+
+    int32_t taps[2];
+    if (picture_gauss_split(ctx->gauss_weights, taps)) {
+        picture_gauss_separable(bits, decoded, source->width, source->height, taps, ctx->get_gauss_rows(source->width));
+    } else {
+        picture_gauss_blur(bits, decoded, source->width, source->height, ctx->gauss_weights);
+    }
+    return bits;
+}
+
+static Result picture_load(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source, vg_lite_color_t color,
+    vg_lite_filter_t filter)
+{
+    uint32_t* image_buffer = filter == VG_LITE_FILTER_GAUSSIAN ? picture_gaussian(ctx, source, color) : picture_decode(ctx, source, color);
+    TVG_CHECK_RETURN_RESULT(picture->load(image_buffer, source->width, source->height, true));
+
+    return Result::Success;
+}
+
+/* (value) rounded to a whole number, false if it is not close to one. */
+static inline bool picture_snap(vg_lite_float_t value, int32_t* snapped)
+{
+    if (!(fabsf(value) < (1 << 24))) {
+        return false;
+    }
+
+    *snapped = (int32_t)lroundf(value);
+    return fabsf(value - *snapped) < 1e-3f;
+}
+
+/* Whether (matrix) turns by (quarter) clockwise quarter turns, 1 to 3, and
+ * translates by whole pixels (offset). Such a mapping moves pixels without
+ * sampling. vg_lite_rotate() leaves rounding noise, which is tolerated.
+ */
+static bool picture_quarter_turn(const vg_lite_matrix_t* matrix, uint32_t* quarter, int32_t offset[2])
+{
+    const vg_lite_float_t(*m)[3] = matrix->m;
+    int32_t a, b, c, d;
+
+    if (m[2][0] != 0 || m[2][1] != 0 || m[2][2] != 1
+        || !picture_snap(m[0][0], &a) || !picture_snap(m[0][1], &b)
+        || !picture_snap(m[1][0], &c) || !picture_snap(m[1][1], &d)
+        || !picture_snap(m[0][2], &offset[0]) || !picture_snap(m[1][2], &offset[1])) {
+        return false;
+    }
+
+    if (a == 0 && d == 0 && b == -1 && c == 1) {
+        *quarter = 1;
+    } else if (a == -1 && d == -1 && b == 0 && c == 0) {
+        *quarter = 2;
+    } else if (a == 0 && d == 0 && b == 1 && c == -1) {
+        *quarter = 3;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/* Load the (area) of the source turned by (quarter) and moved by (offset),
+ * so ThorVG only has to copy it. Point and bilinear sampling are the same
+ * at whole pixel positions.
+ */
+static Result picture_turn(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source,
+    const int32_t area[4], uint32_t quarter, const int32_t offset[2], vg_lite_filter_t filter, vg_lite_color_t color)
+{
+    const uint32_t* bits = filter == VG_LITE_FILTER_GAUSSIAN ? picture_gaussian(ctx, source, color) : picture_decode(ctx, source, color);
+    uint32_t width = area[2] - area[0];
+    uint32_t height = area[3] - area[1];
+    uint32_t turned_width = quarter == 2 ? width : height;
+    uint32_t turned_height = quarter == 2 ? height : width;
+
+    uint32_t* turned = ctx->get_canvas_image(turned_width, turned_height);
+    picture_rotate(turned, bits + area[1] * source->width + area[0], source->width, width, height, quarter);
+    TVG_CHECK_RETURN_RESULT(picture->load(turned, turned_width, turned_height, true));
+
+    /* top left corner of the turned area */
+    int32_t x = quarter == 3 ? area[1] : -(quarter == 1 ? area[3] : area[2]);
+    int32_t y = quarter == 1 ? area[0] : -(quarter == 2 ? area[3] : area[2]);
+    TVG_CHECK_RETURN_RESULT(picture->translate((float)(x + offset[0]), (float)(y + offset[1])));
+
+    return Result::Success;
+}
+
+static inline uint32_t picture_warp_lerp(uint32_t c0, uint32_t c1, uint32_t t)
+{
+    /* two channels per multiply, t in [0, 256) */
+    uint32_t rb = (((c0 & 0x00ff00ff) * (256 - t) + (c1 & 0x00ff00ff) * t) >> 8) & 0x00ff00ff;
+    uint32_t ag = (((c0 >> 8) & 0x00ff00ff) * (256 - t) + ((c1 >> 8) & 0x00ff00ff) * t) & 0xff00ff00;
+    return rb | ag;
+}
+
+/* Offset (t) from the clip origin folded into [0, size) by (mode). */
+static inline int32_t picture_warp_wrap(vg_lite_pattern_mode_t mode, int32_t t, int32_t size)
+{
+    if (mode == VG_LITE_PATTERN_PAD) {
+        return CLAMP(t, 0, size - 1);
+    }
+
+    /* reflected tiles alternate, so they repeat every second tile */
+    int32_t period = mode == VG_LITE_PATTERN_REFLECT ? size * 2 : size;
+    if ((uint32_t)t >= (uint32_t)period) {
+        t %= period;
+        if (t < 0) {
+            t += period;
+        }
+    }
+    return t < size ? t : period - 1 - t;
+}
+
+/* Source pixel (x, y), addressed by the pattern mode outside of (clip). */
+static inline uint32_t picture_warp_texel(const picture_warp_t* warp, int32_t x, int32_t y)
+{
+    const int32_t* clip = warp->clip;
+
+    if (x < clip[0] || y < clip[1] || x >= clip[2] || y >= clip[3]) {
+        if (warp->mode == VG_LITE_PATTERN_COLOR) {
+            return warp->border;
+        }
+        x = clip[0] + picture_warp_wrap(warp->mode, x - clip[0], clip[2] - clip[0]);
+        y = clip[1] + picture_warp_wrap(warp->mode, y - clip[1], clip[3] - clip[1]);
+    }
+    return warp->bits[y * warp->stride + x];
+}
+
+/* Fetch the pixel around the 16.16 source position, addressed by the pattern
+ * mode outside of (clip).
+ */
+static inline uint32_t picture_warp_sample(const picture_warp_t* warp, int32_t fx, int32_t fy)
+{
+    const int32_t* clip = warp->clip;
+
+    if (!warp->bilinear) {
+        return picture_warp_texel(warp, fx >> 16, fy >> 16);
+    }
+
+    /* texel centers are at .5 */
+    fx -= 0x8000;
+    fy -= 0x8000;
+    int32_t x = fx >> 16;
+    int32_t y = fy >> 16;
+    uint32_t ax = (fx >> 8) & 0xff;
+    uint32_t ay = (fy >> 8) & 0xff;
+    const uint32_t* p = warp->bits + y * warp->stride + x;
+    uint32_t c00, c10, c01, c11;
+
+    if (x >= clip[0] && y >= clip[1] && x + 1 < clip[2] && y + 1 < clip[3]) {
+        c00 = p[0];
+        c10 = p[1];
+        c01 = p[warp->stride];
+        c11 = p[warp->stride + 1];
+    } else {
+        if (warp->mode == VG_LITE_PATTERN_COLOR
+            && (x + 1 < clip[0] || y + 1 < clip[1] || x >= clip[2] || y >= clip[3])) {
+            return warp->border;
+        }
+
+        /* edge texels blend with the border color, which antialiases the border,
+         * or with the texels across the seam of the tiles
+         */
+        c00 = picture_warp_texel(warp, x, y);
+        c10 = picture_warp_texel(warp, x + 1, y);
+        c01 = picture_warp_texel(warp, x, y + 1);
+        c11 = picture_warp_texel(warp, x + 1, y + 1);
+    }
+
+    return picture_warp_lerp(picture_warp_lerp(c00, c10, ax), picture_warp_lerp(c01, c11, ax), ay);
+}
+
+/* (t) modulo (period), non negative. */
+static inline int32_t picture_warp_fold(int64_t t, int32_t period)
+{
+    t %= period;
+    return (int32_t)(t < 0 ? t + period : t);
+}
+
+/* Map the device pixels of row (y) from (x) to (x + count) back to the source,
+ * with an exact divide at both ends of the span and linear steps in between.
+ */
+static void picture_warp_span(const picture_warp_t* warp, uint32_t* dest, int32_t x, int32_t y, int32_t count)
+{
+    const double(*m)[3] = warp->inv;
+    double dx = x + 0.5, dy = y + 0.5;
+    double u0 = m[0][0] * dx + m[0][1] * dy + m[0][2];
+    double v0 = m[1][0] * dx + m[1][1] * dy + m[1][2];
+    double w0 = m[2][0] * dx + m[2][1] * dy + m[2][2];
+    double u1 = u0 + m[0][0] * count;
+    double v1 = v0 + m[1][0] * count;
+    double w1 = w0 + m[2][0] * count;
+
+    if (w0 > 0 && w1 > 0) {
+        double x0 = u0 / w0, y0 = v0 / w0;
+        double x1 = u1 / w1, y1 = v1 / w1;
+
+        /* both ends within 16.16 range, in between is too */
+        if (fabs(x0) < 32767 && fabs(y0) < 32767 && fabs(x1) < 32767 && fabs(y1) < 32767) {
+            int32_t fx = (int32_t)(x0 * 65536.0);
+            int32_t fy = (int32_t)(y0 * 65536.0);
+            int32_t sx = (int32_t)((x1 - x0) * 65536.0 / count);
+            int32_t sy = (int32_t)((y1 - y0) * 65536.0 / count);
+
+            if (!warp->period[0]) {
+                while (count--) {
+                    *dest++ = picture_warp_sample(warp, fx, fy);
+                    fx += sx;
+                    fy += sy;
+                }
+                return;
+            }
+
+            /* kept within one period, the steps rarely leave it again */
+            int32_t ox = warp->clip[0] << 16, oy = warp->clip[1] << 16;
+            while (count--) {
+                if ((uint32_t)fx - (uint32_t)ox >= (uint32_t)warp->period[0]) {
+                    fx = ox + picture_warp_fold((int64_t)fx - ox, warp->period[0]);
+                }
+                if ((uint32_t)fy - (uint32_t)oy >= (uint32_t)warp->period[1]) {
+                    fy = oy + picture_warp_fold((int64_t)fy - oy, warp->period[1]);
+                }
+                *dest++ = picture_warp_sample(warp, fx, fy);
+                fx += sx;
+                fy += sy;
+            }
+            return;
+        }
+    }
+
+    /* the span gets close to the horizon, divide every pixel */
+    for (int32_t i = 0; i < count; i++) {
+        double u = u0 + m[0][0] * i;
+        double v = v0 + m[1][0] * i;
+        double w = w0 + m[2][0] * i;
+        uint32_t color = 0;
+
+        if (w > 0) {
+            double sx = u / w, sy = v / w;
+            if (fabs(sx) < 32767 && fabs(sy) < 32767) {
+                color = picture_warp_sample(warp, (int32_t)(sx * 65536.0), (int32_t)(sy * 65536.0));
+            }
+        }
+        dest[i] = color;
+    }
+}
+
+/* Load the source already warped by a projective (matrix) into device space,
+ * ThorVG only maps images affinely and has no wrap addressing. Pixels outside
+ * the source are addressed by (mode), within (area) when set. Leaves (picture)
+ * empty when no pixel of the target is covered.
+ */
+static Result picture_warp(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* target,
+    const vg_lite_buffer_t* source, const vg_lite_rectangle_t* rect, const vg_lite_matrix_t* matrix,
+    vg_lite_filter_t filter, vg_lite_color_t color, const int32_t area[4],
+    vg_lite_pattern_mode_t mode, uint32_t border)
+{
+    picture_warp_t warp;
+    int32_t bounds[4] = { 0, 0, (int32_t)ctx->canvas_width, (int32_t)ctx->canvas_height };
+    ctx->scissor_bounds(bounds);
+
+    if (area) {
+        bounds[0] = MAX(bounds[0], area[0]);
+        bounds[1] = MAX(bounds[1], area[1]);
+        bounds[2] = MIN(bounds[2], area[2]);
+        bounds[3] = MIN(bounds[3], area[3]);
+    }
+
+    warp.clip[0] = 0;
+    warp.clip[1] = 0;
+    warp.clip[2] = source->width;
+    warp.clip[3] = source->height;
+
+    if (rect) {
+        warp.clip[0] = MAX(rect->x, 0);
+        warp.clip[1] = MAX(rect->y, 0);
+        warp.clip[2] = MIN(rect->x + rect->width, warp.clip[2]);
+        warp.clip[3] = MIN(rect->y + rect->height, warp.clip[3]);
+    }
+
+    /* inverse by the adjugate, divided by the determinant to keep w > 0 in front */
+    const float(*m)[3] = matrix->m;
+    double(*inv)[3] = warp.inv;
+    inv[0][0] = (double)m[1][1] * m[2][2] - (double)m[1][2] * m[2][1];
+    inv[0][1] = (double)m[0][2] * m[2][1] - (double)m[0][1] * m[2][2];
+    inv[0][2] = (double)m[0][1] * m[1][2] - (double)m[0][2] * m[1][1];
+    inv[1][0] = (double)m[1][2] * m[2][0] - (double)m[1][0] * m[2][2];
+    inv[1][1] = (double)m[0][0] * m[2][2] - (double)m[0][2] * m[2][0];
+    inv[1][2] = (double)m[0][2] * m[1][0] - (double)m[0][0] * m[1][2];
+    inv[2][0] = (double)m[1][0] * m[2][1] - (double)m[1][1] * m[2][0];
+    inv[2][1] = (double)m[0][1] * m[2][0] - (double)m[0][0] * m[2][1];
+    inv[2][2] = (double)m[0][0] * m[1][1] - (double)m[0][1] * m[1][0];
+
+    double det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+    if (warp.clip[0] >= warp.clip[2] || warp.clip[1] >= warp.clip[3] || det == 0) {
+        picture.reset();
+        return Result::Success;
+    }
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            inv[row][col] /= det;
+        }
+    }
+
+    /* device bounds of the source corners, unbounded when a corner is behind the eye
+     * or the pixels around the source are not transparent
+     */
+    float left = FLT_MAX, top = FLT_MAX, right = -FLT_MAX, bottom = -FLT_MAX;
+    bool bounded = mode == VG_LITE_PATTERN_COLOR && !A(border);
+    for (int i = 0; i < 4 && bounded; i++) {
+        float x = (float)warp.clip[(i & 1) ? 2 : 0];
+        float y = (float)warp.clip[(i & 2) ? 3 : 1];
+        float w = m[2][0] * x + m[2][1] * y + m[2][2];
+        if (w <= 0) {
+            bounded = false;
+            break;
+        }
+        float dx = (m[0][0] * x + m[0][1] * y + m[0][2]) / w;
+        float dy = (m[1][0] * x + m[1][1] * y + m[1][2]) / w;
+        left = MIN(left, dx);
+        top = MIN(top, dy);
+        right = MAX(right, dx);
+        bottom = MAX(bottom, dy);
+    }
+
+    if (bounded) {
+        /* one pixel margin for the bilinear edge */
+        bounds[0] = MAX(bounds[0], (int32_t)floorf(left) - 1);
+        bounds[1] = MAX(bounds[1], (int32_t)floorf(top) - 1);
+        bounds[2] = MIN(bounds[2], (int32_t)ceilf(right) + 1);
+        bounds[3] = MIN(bounds[3], (int32_t)ceilf(bottom) + 1);
+    }
+
+    if (bounds[0] >= bounds[2] || bounds[1] >= bounds[3]) {
+        picture.reset();
+        return Result::Success;
+    }
+
+    warp.bits = filter == VG_LITE_FILTER_GAUSSIAN ? picture_gaussian(ctx, source, color) : picture_decode(ctx, source, color);
+    warp.stride = source->width;
+    warp.bilinear = filter != VG_LITE_FILTER_POINT;
+    warp.mode = mode;
+    warp.border = border;
+    warp.period[0] = 0;
+    warp.period[1] = 0;
+
+    if (mode == VG_LITE_PATTERN_REPEAT || mode == VG_LITE_PATTERN_REFLECT) {
+        /* the spans fold into the first period only while its end stays within 16.16,
+         * beyond that picture_warp_wrap() folds every texel on its own
+         */
+        int32_t tiles = mode == VG_LITE_PATTERN_REFLECT ? 2 : 1;
+        int64_t period_x = (int64_t)(warp.clip[2] - warp.clip[0]) * tiles;
+        int64_t period_y = (int64_t)(warp.clip[3] - warp.clip[1]) * tiles;
+        if (warp.clip[0] + period_x < 32768 && warp.clip[1] + period_y < 32768) {
+            warp.period[0] = (int32_t)(period_x << 16);
+            warp.period[1] = (int32_t)(period_y << 16);
+        }
+    }
+
+    uint32_t width = bounds[2] - bounds[0];
+    uint32_t height = bounds[3] - bounds[1];
+    uint32_t* bits = ctx->get_canvas_image(width, height);
+    uint32_t* dest = bits;
+
+    for (int32_t y = bounds[1]; y < bounds[3]; y++) {
+        for (int32_t x = bounds[0]; x < bounds[2]; x += PICTURE_WARP_SPAN) {
+            int32_t count = MIN(PICTURE_WARP_SPAN, bounds[2] - x);
+            picture_warp_span(&warp, dest, x, y, count);
+            dest += count;
+        }
+    }
+
+    TVG_CHECK_RETURN_RESULT(picture->load(bits, width, height, true));
+    TVG_CHECK_RETURN_RESULT(picture->translate((float)bounds[0], (float)bounds[1]));
+
+    return Result::Success;
+}
+
+static uint32_t grad_ramp_hash(const std::vector<uint8_t>& key)
+{
+    /* FNV-1a */
+    uint32_t hash = 0x811c9dc5;
+    for (uint8_t byte : key) {
+        hash = (hash ^ byte) * 0x01000193;
     }
+    return hash;
+}
 
-    return 0;
+static std::vector<grad_ramp_t>::iterator grad_ramp_find(std::vector<grad_ramp_t>* ramps, const vg_lite_buffer_t* image)
+{
+    for (auto it = ramps->begin(); it != ramps->end(); ++it) {
+        if (image->memory && it->image.memory == image->memory) {
+            return it;
+        }
+    }
+    return ramps->end();
 }
 
-static uint8_t vlc_op_arg_len(uint8_t vlc_op)
+/* Point (image) at a ramp image built from the given ramp. If an identical
+ * ramp image exists it is shared and (cached) is set, otherwise (image) has
+ * to be filled by the caller with (fill_width) texels. The previous image of the gradient is reused
+ * when nobody else shares it and the width is unchanged.
+ */
+static vg_lite_error_t grad_ramp_acquire(vg_lite_ctx* ctx, vg_lite_buffer_t* image, grad_ramp_kind_t kind,
+    uint32_t width, uint32_t fill_width, const vg_lite_color_ramp_t* ramp, uint32_t ramp_length, uint8_t pre_multiplied,
+    vg_lite_gradient_spreadmode_t spread_mode, bool* cached)
 {
-    switch (vlc_op) {
-        VLC_OP_ARG_LEN(END, 0);
-        VLC_OP_ARG_LEN(CLOSE, 0);
-        VLC_OP_ARG_LEN(MOVE, 2);
-        VLC_OP_ARG_LEN(MOVE_REL, 2);
-        VLC_OP_ARG_LEN(LINE, 2);
-        VLC_OP_ARG_LEN(LINE_REL, 2);
-        VLC_OP_ARG_LEN(QUAD, 4);
-        VLC_OP_ARG_LEN(QUAD_REL, 4);
-        VLC_OP_ARG_LEN(CUBIC, 6);
-        VLC_OP_ARG_LEN(CUBIC_REL, 6);
-        VLC_OP_ARG_LEN(SCCWARC, 5);
-        VLC_OP_ARG_LEN(SCCWARC_REL, 5);
-        VLC_OP_ARG_LEN(SCWARC, 5);
-        VLC_OP_ARG_LEN(SCWARC_REL, 5);
-        VLC_OP_ARG_LEN(LCCWARC, 5);
-        VLC_OP_ARG_LEN(LCCWARC_REL, 5);
-        VLC_OP_ARG_LEN(LCWARC, 5);
-        VLC_OP_ARG_LEN(LCWARC_REL, 5);
+    auto ramps = ctx->get_grad_ramps();
+
+    uint32_t params[5] = { (uint32_t)kind, width, fill_width, (uint32_t)pre_multiplied, (uint32_t)spread_mode };
+    std::vector<uint8_t> key(sizeof(params) + ramp_length * sizeof(vg_lite_color_ramp_t));
+    memcpy(key.data(), params, sizeof(params));
+    memcpy(key.data() + sizeof(params), ramp, ramp_length * sizeof(vg_lite_color_ramp_t));
+    uint32_t hash = grad_ramp_hash(key);
+
+    auto cur = grad_ramp_find(ramps, image);
+    if (cur != ramps->end() && cur->hash == hash && cur->key == key) {
+        ctx->stats.grad_cache_hit++;
+        *cached = true;
+        return VG_LITE_SUCCESS;
+    }
+
+    for (auto it = ramps->begin(); it != ramps->end(); ++it) {
+        if (it->hash == hash && it->key == key) {
+            it->ref_count++;
+            vg_lite_buffer_t shared = it->image;
+            if (cur != ramps->end()) {
+                grad_ramp_release(ctx, image);
+            }
+            *image = shared;
+            ctx->stats.grad_cache_hit++;
+            *cached = true;
+            return VG_LITE_SUCCESS;
+        }
+    }
+
+    ctx->stats.grad_cache_miss++;
+    *cached = false;
+
+    /* rebuild in place, the old ramp is not used by anyone else */
+    if (cur != ramps->end() && cur->ref_count == 1 && (uint32_t)cur->image.width == width) {
+        cur->hash = hash;
+        cur->key = std::move(key);
+        return VG_LITE_SUCCESS;
+    }
+
+    /* Anything else in (image) is not ours to free, the gradient may not
+     * have been updated before. */
+    if (cur != ramps->end()) {
+        grad_ramp_release(ctx, image);
+    }
+
+    grad_ramp_t entry;
+    memset(&entry.image, 0, sizeof(entry.image));
+    entry.image.width = width;
+    entry.image.height = 1;
+    entry.image.stride = 0;
+    entry.image.image_mode = VG_LITE_NONE_IMAGE_MODE;
+    entry.image.format = VG_LITE_ABGR8888;
+
+    /* Allocate the image for gradient. */
+    vg_lite_error_t error;
+    VG_LITE_RETURN_ERROR(vg_lite_allocate(&entry.image));
+
+    entry.hash = hash;
+    entry.ref_count = 1;
+    entry.key = std::move(key);
+    *image = entry.image;
+    ramps->push_back(std::move(entry));
+
+    return VG_LITE_SUCCESS;
+}
+
+static vg_lite_error_t grad_ramp_release(vg_lite_ctx* ctx, vg_lite_buffer_t* image)
+{
+    auto ramps = ctx->get_grad_ramps();
+    auto it = grad_ramp_find(ramps, image);
+
+    if (it == ramps->end()) {
+        /* not a ramp image, owned by the gradient alone */
+        return image->handle ? vg_lite_free(image) : VG_LITE_SUCCESS;
+    }
+
+    if (--it->ref_count == 0) {
+        vg_lite_free(&it->image);
+        ramps->erase(it);
+    }
+
+    memset(image, 0, sizeof(vg_lite_buffer_t));
+    return VG_LITE_SUCCESS;
+}
+
+/* Color of a ramp stop as {red, green, blue, alpha}. */
+static void grad_ramp_color(const vg_lite_color_ramp_t* ramp, uint8_t pre_multiplied, FLOATVECTOR4 color)
+{
+    color[0] = ramp->red;
+    color[1] = ramp->green;
+    color[2] = ramp->blue;
+    color[3] = ramp->alpha;
+
+    if (pre_multiplied) {
+        color[0] *= color[3];
+        color[1] *= color[3];
+        color[2] *= color[3];
+    }
+}
+
+/* Texels are stored as A, B, G, R bytes (VG_LITE_ABGR8888). */
+static inline uint32_t grad_ramp_pack(const FLOATVECTOR4 color)
+{
+    return (uint32_t)PackColorComponent(color[3])
+        | ((uint32_t)PackColorComponent(color[2]) << 8)
+        | ((uint32_t)PackColorComponent(color[1]) << 16)
+        | ((uint32_t)PackColorComponent(color[0]) << 24);
+}
+
+#if defined(__SSE2__)
+static inline __m128i grad_ramp_lerp_sse2(float c1, float c2, __m128 weight, __m128 weight1)
+{
+    __m128 color = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c1), weight), _mm_mul_ps(_mm_set1_ps(c2), weight1));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+#endif
+
+/* Fill the texels [begin, end) lying strictly between two ramp stops. Every
+ * texel goes through the same float operations as a single texel would, four
+ * texels at a time, so the vector and the scalar loops agree bit for bit.
+ */
+static void grad_ramp_fill_span(uint32_t* bits, uint32_t begin, uint32_t end, vg_lite_float_t last,
+    const vg_lite_color_ramp_t* ramp0, const vg_lite_color_ramp_t* ramp1, uint8_t pre_multiplied)
+{
+    FLOATVECTOR4 color1, color2;
+    grad_ramp_color(ramp0, pre_multiplied, color1);
+    grad_ramp_color(ramp1, pre_multiplied, color2);
+
+    vg_lite_float_t stop = ramp1->stop;
+    vg_lite_float_t range = ramp1->stop - ramp0->stop;
+    uint32_t i = begin;
+
+#if defined(__SSE2__)
+    __m128i index = _mm_setr_epi32(i, i + 1, i + 2, i + 3);
+    for (; i + 4 <= end; i += 4) {
+        __m128 gradient = _mm_div_ps(_mm_cvtepi32_ps(index), _mm_set1_ps(last));
+        __m128 weight = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(stop), gradient), _mm_set1_ps(range));
+        __m128 weight1 = _mm_sub_ps(_mm_set1_ps(1.0f), weight);
+
+        __m128i a = grad_ramp_lerp_sse2(color1[3], color2[3], weight, weight1);
+        __m128i b = grad_ramp_lerp_sse2(color1[2], color2[2], weight, weight1);
+        __m128i g = grad_ramp_lerp_sse2(color1[1], color2[1], weight, weight1);
+        __m128i r = grad_ramp_lerp_sse2(color1[0], color2[0], weight, weight1);
+
+        /* a0..a3 g0..g3 b0..b3 r0..r3, saturated to 0..255 */
+        __m128i texels = _mm_packus_epi16(_mm_packs_epi32(a, g), _mm_packs_epi32(b, r));
+        /* a0 b0 a1 b1 .. g0 r0 g1 r1 .. */
+        texels = _mm_unpacklo_epi8(texels, _mm_srli_si128(texels, 8));
+        /* a0 b0 g0 r0 a1 b1 g1 r1 .. */
+        texels = _mm_unpacklo_epi16(texels, _mm_srli_si128(texels, 8));
+        _mm_storeu_si128((__m128i*)(bits + i), texels);
+
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+#endif
+
+    for (; i < end; i++) {
+        vg_lite_float_t gradient = (vg_lite_float_t)i / last;
+        vg_lite_float_t weight = (stop - gradient) / range;
+        FLOATVECTOR4 color;
+
+        color[3] = LERP(color1[3], color2[3], weight);
+        color[2] = LERP(color1[2], color2[2], weight);
+        color[1] = LERP(color1[1], color2[1], weight);
+        color[0] = LERP(color1[0], color2[0], weight);
+        bits[i] = grad_ramp_pack(color);
+    }
+}
+
+/* Fill (width) texels of a ramp image, texel i sits at i / (width - 1). The
+ * stop search only runs at the segment ends, the texels in between are
+ * filled as a whole.
+ */
+static vg_lite_error_t grad_ramp_fill(uint32_t* bits, uint32_t width, const vg_lite_color_ramp_t* ramp, uint8_t pre_multiplied)
+{
+    vg_lite_float_t last = (vg_lite_float_t)(width - 1);
+    uint32_t stop = 0;
+    uint32_t i = 0;
+
+    while (i < width) {
+        vg_lite_float_t gradient = (vg_lite_float_t)i / last;
+
+        /* Find the entry in the color ramp that matches or exceeds this
+        ** gradient. */
+        while (gradient > ramp[stop].stop) {
+            ++stop;
+        }
+
+        if (gradient == ramp[stop].stop) {
+            /* Perfect match weight 1.0. */
+            FLOATVECTOR4 color;
+            grad_ramp_color(&ramp[stop], pre_multiplied, color);
+            bits[i++] = grad_ramp_pack(color);
+            continue;
+        }
+
+        if (stop == 0) {
+            return VG_LITE_INVALID_ARGUMENT;
+        }
+
+        /* The texels are monotonic in i, estimate where the segment ends and
+         * settle it with the same compare as above. */
+        uint32_t end = (uint32_t)(ramp[stop].stop * last);
+        end = MAX(end, i + 1);
+        end = MIN(end, width);
+        while (end < width && (vg_lite_float_t)end / last < ramp[stop].stop) {
+            end++;
+        }
+        while (end > i + 1 && (vg_lite_float_t)(end - 1) / last >= ramp[stop].stop) {
+            end--;
+        }
+
+        grad_ramp_fill_span(bits, i, end, last, &ramp[stop - 1], &ramp[stop], pre_multiplied);
+        i = end;
+    }
+
+    return VG_LITE_SUCCESS;
+}
+
+/* Fill texels 1..ds-1 from color0 towards color1 as color0 + delta * j / ds
+ * per channel. The quotient and the remainder are stepped from texel to
+ * texel instead of dividing, which gives the exact same truncated values.
+ */
+static void grad_ramp_fill_dda(uint32_t* bits, uint32_t color0, uint32_t color1, int32_t ds)
+{
+    int32_t from[4], quot[4], rem[4], sign[4];
+
+    /* channels in B, G, R, A order */
+    for (int k = 0; k < 4; k++) {
+        int32_t c0 = (color0 >> (k * 8)) & 0xff;
+        int32_t delta = (int32_t)((color1 >> (k * 8)) & 0xff) - c0;
+        from[k] = c0;
+        sign[k] = delta < 0 ? -1 : 0;
+        delta = delta < 0 ? -delta : delta;
+        quot[k] = delta / ds;
+        rem[k] = delta % ds;
+    }
+
+#if defined(__SSE2__)
+    __m128i v_from = _mm_loadu_si128((const __m128i*)from);
+    __m128i v_quot = _mm_loadu_si128((const __m128i*)quot);
+    __m128i v_rem = _mm_loadu_si128((const __m128i*)rem);
+    __m128i v_sign = _mm_loadu_si128((const __m128i*)sign);
+    __m128i v_ds = _mm_set1_epi32(ds);
+    __m128i v_ds1 = _mm_set1_epi32(ds - 1);
+    __m128i acc_quot = _mm_setzero_si128();
+    __m128i acc_rem = _mm_setzero_si128();
+
+    for (int32_t j = 1; j < ds; j++) {
+        acc_quot = _mm_add_epi32(acc_quot, v_quot);
+        acc_rem = _mm_add_epi32(acc_rem, v_rem);
+
+        __m128i carry = _mm_cmpgt_epi32(acc_rem, v_ds1);
+        acc_quot = _mm_sub_epi32(acc_quot, carry);
+        acc_rem = _mm_sub_epi32(acc_rem, _mm_and_si128(carry, v_ds));
+
+        __m128i color = _mm_add_epi32(v_from, _mm_sub_epi32(_mm_xor_si128(acc_quot, v_sign), v_sign));
+        color = _mm_packs_epi32(color, color);
+        bits[j] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(color, color));
+    }
+#else
+    int32_t acc_quot[4] = { 0 };
+    int32_t acc_rem[4] = { 0 };
+
+    for (int32_t j = 1; j < ds; j++) {
+        uint32_t color = 0;
+        for (int k = 0; k < 4; k++) {
+            acc_quot[k] += quot[k];
+            acc_rem[k] += rem[k];
+            if (acc_rem[k] >= ds) {
+                acc_quot[k]++;
+                acc_rem[k] -= ds;
+            }
+            color |= (uint32_t)(from[k] + ((acc_quot[k] ^ sign[k]) - sign[k])) << (k * 8);
+        }
+        bits[j] = color;
+    }
+#endif
+}
+
+static Fill::ColorStop grad_fill_stop(float offset, const FLOATVECTOR4 color)
+{
+    Fill::ColorStop stop;
+    stop.offset = offset;
+    stop.r = PackColorComponent(color[0]);
+    stop.g = PackColorComponent(color[1]);
+    stop.b = PackColorComponent(color[2]);
+    stop.a = PackColorComponent(color[3]);
+    return stop;
+}
+
+/* Take (stops) into the light of the canvas, like the paint colors. */
+static void grad_fill_canvas_stops(vg_lite_ctx* ctx, Fill::ColorStop* stops, uint32_t count)
+{
+    const uint8_t* table = ctx->get_canvas_gamma();
+    if (!table) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        stops[i].r = table[stops[i].r];
+        stops[i].g = table[stops[i].g];
+        stops[i].b = table[stops[i].b];
+    }
+}
+
+/* FILL is padded with paint_color by the color stops. */
+static FillSpread grad_fill_spread(vg_lite_gradient_spreadmode_t spread_mode)
+{
+    switch (spread_mode) {
+    case VG_LITE_GRADIENT_SPREAD_REPEAT:
+        return FillSpread::Repeat;
+    case VG_LITE_GRADIENT_SPREAD_REFLECT:
+        return FillSpread::Reflect;
     default:
-        TVG_LOG("UNKNOW_VLC_OP: 0x%x", vlc_op);
-        TVG_ASSERT(false);
         break;
     }
+    return FillSpread::Pad;
+}
 
-    return 0;
+/* Premultiplied color of the two (stops) at (t) along the gradient, after
+ * (spread_mode). A (pre_multiplied) ramp is interpolated premultiplied.
+ */
+static uint32_t grad_axis_color(const Fill::ColorStop stops[2], float t, vg_lite_gradient_spreadmode_t spread_mode,
+    uint8_t pre_multiplied)
+{
+    if (spread_mode == VG_LITE_GRADIENT_SPREAD_REPEAT) {
+        t -= floorf(t);
+    } else if (spread_mode == VG_LITE_GRADIENT_SPREAD_REFLECT) {
+        t -= 2 * floorf(t * 0.5f);
+        t = t > 1 ? 2 - t : t;
+    }
+
+    /* weight of the first stop */
+    float w;
+    if (t <= stops[0].offset) {
+        w = 1;
+    } else if (t >= stops[1].offset) {
+        w = 0;
+    } else {
+        w = (stops[1].offset - t) / (stops[1].offset - stops[0].offset);
+    }
+
+    float a0 = stops[0].a, a1 = stops[1].a;
+    float a = LERP(a0, a1, w);
+    float k0 = pre_multiplied ? a0 / 255 : a / 255;
+    float k1 = pre_multiplied ? a1 / 255 : a / 255;
+    uint32_t alpha = (uint32_t)(a + 0.5f);
+    uint32_t r = (uint32_t)(LERP(stops[0].r * k0, stops[1].r * k1, w) + 0.5f);
+    uint32_t g = (uint32_t)(LERP(stops[0].g * k0, stops[1].g * k1, w) + 0.5f);
+    uint32_t b = (uint32_t)(LERP(stops[0].b * k0, stops[1].b * k1, w) + 0.5f);
+    r = MIN(r, alpha);
+    g = MIN(g, alpha);
+    b = MIN(b, alpha);
+    return (alpha << 24) | (r << 16) | (g << 8) | b;
 }
 
-static Result shape_append_path(std::unique_ptr<Shape>& shape, vg_lite_path_t* path, vg_lite_matrix_t* matrix)
+/* A two stop gradient that runs along a device axis changes color once per
+ * row or column. It is evaluated here for the device bounds of the path and
+ * drawn as an image the path clips, without the color ramp, the cached stops
+ * or a ThorVG fill. (drawn) is false when (grad) needs the general fill.
+ */
+static Result grad_axis_push(vg_lite_ctx* ctx, const vg_lite_ext_linear_gradient_t* grad, vg_lite_path_t* path,
+    vg_lite_fill_t fill_rule, vg_lite_matrix_t* path_matrix, vg_lite_blend_t blend, bool* drawn)
 {
-    uint8_t fmt_len = vlc_format_len(path->format);
-    uint8_t* cur = (uint8_t*)path->path;
-    uint8_t* end = cur + path->path_length;
+    const vg_lite_matrix_t* m = &grad->matrix;
+    const vg_lite_color_ramp_t* ramp = grad->color_ramp;
+    *drawn = false;
+
+    /* two stops the converted ramp kept, padded to offsets 0 and 1 with their colors */
+    if (grad->ramp_length != 2 || ramp[0].stop < 0.0f || ramp[1].stop > 1.0f || ramp[0].stop > ramp[1].stop
+        || grad->spread_mode == VG_LITE_GRADIENT_SPREAD_FILL
+        || vg_lite_tvg_matrix_classify(m) > VG_LITE_TVG_MATRIX_SCALE) {
+        return Result::Success;
+    }
 
-    while (cur < end) {
-        /* get op code */
-        uint8_t op_code = VLC_GET_OP_CODE(cur);
+    /* the end points in the target */
+    float x0 = grad->linear_grad.X0 * m->m[0][0] + m->m[0][2];
+    float y0 = grad->linear_grad.Y0 * m->m[1][1] + m->m[1][2];
+    float x1 = grad->linear_grad.X1 * m->m[0][0] + m->m[0][2];
+    float y1 = grad->linear_grad.Y1 * m->m[1][1] + m->m[1][2];
+    bool vertical = x0 == x1;
+    if (vertical == (y0 == y1)) {
+        return Result::Success;
+    }
 
-        /* get arguments length */
-        uint8_t arg_len = vlc_op_arg_len(op_code);
+    *drawn = true;
+    path_raster_t* raster = ctx->get_path_raster();
+    path_raster_parse(raster, path, path_matrix);
 
-        /* skip op code */
-        cur += fmt_len;
+    int32_t bounds[4] = { 0, 0, (int32_t)ctx->canvas_width, (int32_t)ctx->canvas_height };
+    bool clip = true;
+    if (path_raster_device_bounds(raster, bounds) && !draw_visible(ctx, bounds, &clip)) {
+        return Result::Success;
+    }
 
-        switch (op_code) {
-        case VLC_OP_MOVE: {
-            float x = VLC_GET_ARG(cur, 0);
-            float y = VLC_GET_ARG(cur, 1);
-            TVG_CHECK_RETURN_RESULT(shape->moveTo(x, y));
-        } break;
+    int32_t left = MAX(bounds[0], 0);
+    int32_t top = MAX(bounds[1], 0);
+    int32_t right = MIN(bounds[2], (int32_t)ctx->canvas_width);
+    int32_t bottom = MIN(bounds[3], (int32_t)ctx->canvas_height);
+    if (left >= right || top >= bottom) {
+        return Result::Success;
+    }
 
-        case VLC_OP_LINE: {
-            float x = VLC_GET_ARG(cur, 0);
-            float y = VLC_GET_ARG(cur, 1);
-            TVG_CHECK_RETURN_RESULT(shape->lineTo(x, y));
-        } break;
+    /* the clamped colors of the converted ramp */
+    Fill::ColorStop stops[2];
+    FLOATVECTOR4 color;
+    grad_ramp_color(&grad->converted_ramp[0], 0, color);
+    stops[0] = grad_fill_stop(ramp[0].stop, color);
+    grad_ramp_color(&grad->converted_ramp[grad->converted_length - 1], 0, color);
+    stops[1] = grad_fill_stop(ramp[1].stop, color);
+    grad_fill_canvas_stops(ctx, stops, 2);
+
+    uint32_t width = right - left;
+    uint32_t height = bottom - top;
+    uint32_t* bits = ctx->get_canvas_image(width, height);
+
+    /* sampled at the pixel centers, like the ThorVG fill */
+    if (vertical) {
+        float scale = 1.0f / (y1 - y0);
+        for (uint32_t y = 0; y < height; y++) {
+            float t = (top + y + 0.5f - y0) * scale;
+            uint32_t c = grad_axis_color(stops, t, grad->spread_mode, grad->pre_multiplied);
+            uint32_t* row = bits + y * width;
+            uint32_t x = 0;
+#if defined(__SSE2__)
+            __m128i v = _mm_set1_epi32((int)c);
+            for (; x + 4 <= width; x += 4) {
+                _mm_storeu_si128((__m128i*)(row + x), v);
+            }
+#endif
+            for (; x < width; x++) {
+                row[x] = c;
+            }
+        }
+    } else {
+        float scale = 1.0f / (x1 - x0);
+        for (uint32_t x = 0; x < width; x++) {
+            float t = (left + x + 0.5f - x0) * scale;
+            bits[x] = grad_axis_color(stops, t, grad->spread_mode, grad->pre_multiplied);
+        }
+        for (uint32_t y = 1; y < height; y++) {
+            memcpy(bits + y * width, bits, width * sizeof(uint32_t));
+        }
+    }
 
-        case VLC_OP_QUAD: {
-            /* hack pre point */
-            float qcx0 = VLC_GET_ARG(cur, -3);
-            float qcy0 = VLC_GET_ARG(cur, -2);
-            float qcx1 = VLC_GET_ARG(cur, 0);
-            float qcy1 = VLC_GET_ARG(cur, 1);
-            float x = VLC_GET_ARG(cur, 2);
-            float y = VLC_GET_ARG(cur, 3);
+    auto shape = Shape::gen();
+    TVG_CHECK_RETURN_RESULT(shape_append_raster(shape.get(), raster, path));
+    TVG_CHECK_RETURN_RESULT(shape->fill(fill_rule_conv(fill_rule)));
+    TVG_CHECK_RETURN_RESULT(shape->transform(matrix_conv(path_matrix)));
+
+    auto picture = Picture::gen();
+    TVG_CHECK_RETURN_RESULT(picture->load(bits, width, height, true));
+    TVG_CHECK_RETURN_RESULT(picture->translate((float)left, (float)top));
+    TVG_CHECK_RETURN_RESULT(picture->blend(blend_method_conv(blend)));
+    TVG_CHECK_RETURN_RESULT(picture->composite(std::move(shape), CompositeMethod::ClipPath));
+    return ctx->push(std::move(picture), clip);
+}
 
-            qcx0 += (qcx1 - qcx0) * 2 / 3;
-            qcy0 += (qcy1 - qcy0) * 2 / 3;
-            qcx1 = x + (qcx1 - x) * 2 / 3;
-            qcy1 = y + (qcy1 - y) * 2 / 3;
+/* The cached fill of (grad), NULL if it has to be (re)built. */
+static Fill* grad_fill_find(vg_lite_ctx* ctx, const void* grad, vg_lite_gradient_spreadmode_t spread_mode, vg_lite_color_t paint_color)
+{
+    for (auto& entry : *ctx->get_grad_fills()) {
+        if (entry.grad == grad) {
+            if (spread_mode == VG_LITE_GRADIENT_SPREAD_FILL && entry.paint_color != paint_color) {
+                return NULL;
+            }
+            return entry.fill.get();
+        }
+    }
+    return NULL;
+}
 
-            TVG_CHECK_RETURN_RESULT(shape->cubicTo(qcx0, qcy0, qcx1, qcy1, x, y));
-        } break;
+/* Set the color stops and the spread of (fill) from a converted color ramp
+ * and cache it for (grad).
+ *
+ * ThorVG interpolates the stops in straight alpha, so a premultiplied ramp
+ * gets a few intermediate stops wherever the alpha changes. Spread mode
+ * FILL is padded with paint_color just outside of the ramp: the drawing
+ * extends the gradient geometry by GRAD_FILL_SPREAD_FILL_MARGIN past offset
+ * 1, and for a linear gradient past offset 0 too, and the stops are mapped
+ * onto the extended geometry so they stay where the user put them. A radial
+ * ramp has nothing before offset 0, its center keeps the first stop.
+ */
+static Result grad_fill_store(vg_lite_ctx* ctx, const void* grad, std::unique_ptr<Fill> fill, grad_ramp_kind_t kind,
+    const vg_lite_color_ramp_t* ramp, uint32_t ramp_length, uint8_t pre_multiplied,
+    vg_lite_gradient_spreadmode_t spread_mode, vg_lite_color_t paint_color)
+{
+    std::vector<Fill::ColorStop> stops;
+    float offset = 0.0f;
+    float range = 1.0f;
+    FLOATVECTOR4 color, paint;
+
+    paint[0] = B(paint_color) / 255.0f;
+    paint[1] = G(paint_color) / 255.0f;
+    paint[2] = R(paint_color) / 255.0f;
+    paint[3] = A(paint_color) / 255.0f;
+
+    if (spread_mode == VG_LITE_GRADIENT_SPREAD_FILL) {
+        if (kind == GRAD_RAMP_LINEAR) {
+            stops.push_back(grad_fill_stop(0.0f, paint));
+            offset = GRAD_FILL_SPREAD_FILL_MARGIN / (1.0f + 2 * GRAD_FILL_SPREAD_FILL_MARGIN);
+            range = 1.0f / (1.0f + 2 * GRAD_FILL_SPREAD_FILL_MARGIN);
+        } else {
+            range = 1.0f / (1.0f + GRAD_FILL_SPREAD_FILL_MARGIN);
+        }
+    }
+
+    for (uint32_t i = 0; i < ramp_length; i++) {
+        if (pre_multiplied && i > 0 && ramp[i - 1].alpha != ramp[i].alpha) {
+            FLOATVECTOR4 color1, color2;
+            grad_ramp_color(&ramp[i - 1], 1, color1);
+            grad_ramp_color(&ramp[i], 1, color2);
+
+            for (int k = 1; k < GRAD_FILL_PREMULTIPLY_STEPS; k++) {
+                float weight = 1.0f - (float)k / GRAD_FILL_PREMULTIPLY_STEPS;
+                float alpha = LERP(color1[3], color2[3], weight);
+                for (int c = 0; c < 3; c++) {
+                    color[c] = alpha > 0.0f ? LERP(color1[c], color2[c], weight) / alpha : 0.0f;
+                }
+                color[3] = alpha;
+                float stop = LERP(ramp[i - 1].stop, ramp[i].stop, weight);
+                stops.push_back(grad_fill_stop(offset + stop * range, color));
+            }
+        }
+
+        grad_ramp_color(&ramp[i], 0, color);
+        stops.push_back(grad_fill_stop(offset + ramp[i].stop * range, color));
+    }
+
+    if (spread_mode == VG_LITE_GRADIENT_SPREAD_FILL) {
+        stops.push_back(grad_fill_stop(1.0f, paint));
+    }
+
+    grad_fill_canvas_stops(ctx, stops.data(), stops.size());
+    TVG_CHECK_RETURN_RESULT(fill->colorStops(stops.data(), stops.size()));
+    TVG_CHECK_RETURN_RESULT(fill->spread(grad_fill_spread(spread_mode)));
+
+    grad_fill_insert(ctx, grad, paint_color, std::move(fill));
+    return Result::Success;
+}
+
+static void grad_fill_insert(vg_lite_ctx* ctx, const void* grad, vg_lite_color_t paint_color, std::unique_ptr<Fill> fill)
+{
+    auto fills = ctx->get_grad_fills();
+    for (auto& entry : *fills) {
+        if (entry.grad == grad) {
+            entry.paint_color = paint_color;
+            entry.fill = std::move(fill);
+            return;
+        }
+    }
+
+    grad_fill_t entry;
+    entry.grad = grad;
+    entry.paint_color = paint_color;
+    entry.fill = std::move(fill);
+    fills->push_back(std::move(entry));
+}
+
+/* Compile a vg_lite_linear_gradient_t into a cached fill. The ramp runs
+ * along the x axis of the gradient space, one unit per texel of the ramp
+ * image, and stops sit at the texel centers. The fill owns a copy of the
+ * stops, so draws pending until vg_lite_finish() don't depend on the ramp
+ * image of the gradient.
+ */
+static Result grad_fill_compile(vg_lite_ctx* ctx, const vg_lite_linear_gradient_t* grad, Fill** fill)
+{
+    std::vector<Fill::ColorStop> stops;
+
+#ifdef CONFIG_VG_LITE_TVG_GRAD_SAMPLE_RAMP
+    /* one stop per texel of the ramp computed by vg_lite_update_grad() */
+    const uint32_t* ramp = (const uint32_t*)grad->image.memory;
+    if (!ramp || !grad->count) {
+        return Result::InvalidArguments;
+    }
+
+    stops.resize(VLC_GRADIENT_BUFFER_WIDTH);
+    for (uint32_t i = 0; i < VLC_GRADIENT_BUFFER_WIDTH; i++) {
+        stops[i].offset = (i + 0.5f) / VLC_GRADIENT_BUFFER_WIDTH;
+        stops[i].r = R(ramp[i]);
+        stops[i].g = G(ramp[i]);
+        stops[i].b = B(ramp[i]);
+        stops[i].a = A(ramp[i]);
+    }
+#else
+    if (!grad->count) {
+        return Result::InvalidArguments;
+    }
+
+    stops.resize(grad->count);
+    for (uint32_t i = 0; i < grad->count; i++) {
+        stops[i].offset = (grad->stops[i] + 0.5f) / VLC_GRADIENT_BUFFER_WIDTH;
+        stops[i].r = R(grad->colors[i]);
+        stops[i].g = G(grad->colors[i]);
+        stops[i].b = B(grad->colors[i]);
+        stops[i].a = A(grad->colors[i]);
+    }
+#endif
+
+    grad_fill_canvas_stops(ctx, stops.data(), stops.size());
+
+    auto linearGrad = LinearGradient::gen();
+    TVG_CHECK_RETURN_RESULT(linearGrad->linear(0, 0, VLC_GRADIENT_BUFFER_WIDTH, 0));
+    TVG_CHECK_RETURN_RESULT(linearGrad->colorStops(stops.data(), stops.size()));
+    TVG_CHECK_RETURN_RESULT(linearGrad->spread(FillSpread::Pad));
+
+    *fill = linearGrad.get();
+    grad_fill_insert(ctx, grad, 0, std::move(linearGrad));
+    return Result::Success;
+}
+
+static void grad_fill_release(vg_lite_ctx* ctx, const void* grad)
+{
+    auto fills = ctx->get_grad_fills();
+    for (auto it = fills->begin(); it != fills->end(); ++it) {
+        if (it->grad == grad) {
+            fills->erase(it);
+            return;
+        }
+    }
+}
+
+/* The gradient matrix maps the gradient to the target like the path matrix
+ * does for the path. ThorVG applies the fill transform before the shape
+ * transform, so the fill gets inverse(path_matrix) * grad_matrix.
+ */
+static bool grad_fill_matrix(const vg_lite_matrix_t* path_matrix, const vg_lite_matrix_t* grad_matrix, vg_lite_matrix_t* matrix)
+{
+    switch (vg_lite_tvg_matrix_classify(path_matrix)) {
+    case VG_LITE_TVG_MATRIX_IDENTITY:
+        *matrix = *grad_matrix;
+        return true;
+
+    case VG_LITE_TVG_MATRIX_TRANSLATE:
+        /* rows 0 and 1 minus the translation times row 2 */
+        for (int col = 0; col < 3; col++) {
+            matrix->m[0][col] = grad_matrix->m[0][col] - path_matrix->m[0][2] * grad_matrix->m[2][col];
+            matrix->m[1][col] = grad_matrix->m[1][col] - path_matrix->m[1][2] * grad_matrix->m[2][col];
+            matrix->m[2][col] = grad_matrix->m[2][col];
+        }
+        return true;
+
+    default:
+        break;
+    }
+
+    const float(*m)[3] = path_matrix->m;
+    float inv[3][3];
+
+    inv[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    inv[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    inv[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    inv[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    inv[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    inv[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    inv[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    inv[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+    inv[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+    float det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+    if (math_zero(det)) {
+        return false;
+    }
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            matrix->m[row][col] = (inv[row][0] * grad_matrix->m[0][col]
+                                      + inv[row][1] * grad_matrix->m[1][col]
+                                      + inv[row][2] * grad_matrix->m[2][col])
+                / det;
+        }
+    }
+
+    return true;
+}
+
+/* Clip (rect), the whole layer if NULL, to the layer: left, top, right, bottom. */
+static bool mask_area(const vg_lite_buffer_t* masklayer, const vg_lite_rectangle_t* rect, int32_t area[4])
+{
+    if (!rect) {
+        area[0] = area[1] = 0;
+        area[2] = masklayer->width;
+        area[3] = masklayer->height;
+    } else {
+        area[0] = MAX(rect->x, 0);
+        area[1] = MAX(rect->y, 0);
+        area[2] = MIN(rect->x + rect->width, masklayer->width);
+        area[3] = MIN(rect->y + rect->height, masklayer->height);
+    }
+
+    return area[0] < area[2] && area[1] < area[3];
+}
+
+static void mask_fill(vg_lite_buffer_t* masklayer, const int32_t area[4], uint8_t value)
+{
+    for (int32_t y = area[1]; y < area[3]; y++) {
+        memset((uint8_t*)masklayer->memory + y * masklayer->stride + area[0], value, area[2] - area[0]);
+    }
+}
 
-        case VLC_OP_CUBIC: {
-            float cx1 = VLC_GET_ARG(cur, 0);
-            float cy1 = VLC_GET_ARG(cur, 1);
-            float cx2 = VLC_GET_ARG(cur, 2);
-            float cy2 = VLC_GET_ARG(cur, 3);
-            float x = VLC_GET_ARG(cur, 4);
-            float y = VLC_GET_ARG(cur, 5);
-            TVG_CHECK_RETURN_RESULT(shape->cubicTo(cx1, cy1, cx2, cy2, x, y));
-        } break;
+#if defined(__SSE2__)
+/* UDIV255() of the 16 products a * b. */
+static inline __m128i mask_mul_sse2(__m128i a, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i div = _mm_set1_epi16((short)0x8081);
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    lo = _mm_srli_epi16(_mm_mulhi_epu16(lo, div), 7);
+    hi = _mm_srli_epi16(_mm_mulhi_epu16(hi, div), 7);
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
 
-        case VLC_OP_CLOSE:
-        case VLC_OP_END: {
-            TVG_CHECK_RETURN_RESULT(shape->close());
-        } break;
+/* Combine (count) mask values of (src) into (dst), a NULL (src) is all 0. */
+static void mask_blend_span(uint8_t* dst, const uint8_t* src, uint32_t count, vg_lite_mask_operation_t operation)
+{
+    uint32_t i = 0;
+
+    switch (operation) {
+    case VG_LITE_CLEAR_MASK:
+        memset(dst, 0, count);
+        return;
+
+    case VG_LITE_FILL_MASK:
+        memset(dst, 0xff, count);
+        return;
+
+    case VG_LITE_SET_MASK:
+    case VG_LITE_INTERSECT_MASK:
+        if (!src) {
+            memset(dst, 0, count);
+            return;
+        }
+        if (operation == VG_LITE_SET_MASK) {
+            memcpy(dst, src, count);
+            return;
+        }
+        break;
 
-        default:
-            break;
+    case VG_LITE_UNION_MASK:
+    case VG_LITE_SUBTRACT_MASK:
+        if (!src) {
+            return;
         }
+        break;
 
-        cur += arg_len * fmt_len;
+    default:
+        TVG_LOG("unsupport mask operation: 0x%x\n", operation);
+        return;
     }
 
-    float x_min = path->bounding_box[0];
-    float y_min = path->bounding_box[1];
-    float x_max = path->bounding_box[2];
-    float y_max = path->bounding_box[3];
+#if defined(__SSE2__)
+    const __m128i ff = _mm_set1_epi8((char)0xff);
+    for (; i + 16 <= count; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+        if (operation == VG_LITE_UNION_MASK) {
+            /* s + d - s * d never exceeds 255 */
+            d = _mm_sub_epi8(_mm_add_epi8(s, d), mask_mul_sse2(s, d));
+        } else if (operation == VG_LITE_INTERSECT_MASK) {
+            d = mask_mul_sse2(s, d);
+        } else {
+            d = mask_mul_sse2(_mm_xor_si128(s, ff), d);
+        }
 
-    if (math_equal(x_min, __FLT_MIN__) && math_equal(y_min, __FLT_MIN__)
-        && math_equal(x_max, __FLT_MAX__) && math_equal(y_max, __FLT_MAX__)) {
-        return Result::Success;
+        _mm_storeu_si128((__m128i*)(dst + i), d);
     }
+#endif
 
-    auto cilp = Shape::gen();
-    TVG_CHECK_RETURN_RESULT(cilp->appendRect(x_min, y_min, x_max - x_min, y_max - y_min, 0, 0));
-    TVG_CHECK_RETURN_RESULT(cilp->transform(matrix_conv(matrix)));
-    TVG_CHECK_RETURN_RESULT(shape->composite(std::move(cilp), CompositeMethod::ClipPath));
+    for (; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t d = dst[i];
 
-    return Result::Success;
+        if (operation == VG_LITE_UNION_MASK) {
+            dst[i] = s + d - UDIV255(s * d);
+        } else if (operation == VG_LITE_INTERSECT_MASK) {
+            dst[i] = UDIV255(s * d);
+        } else {
+            dst[i] = UDIV255((255 - s) * d);
+        }
+    }
 }
 
-static Result shape_append_rect(std::unique_ptr<Shape>& shape, const vg_lite_buffer_t* target, const vg_lite_rectangle_t* rect)
+/* Alpha channel of (count) ARGB pixels, (dst) may overlap the start of (src). */
+static void mask_alpha_span(uint8_t* dst, const uint32_t* src, uint32_t count)
 {
-    if (rect) {
-        TVG_CHECK_RETURN_RESULT(shape->appendRect(rect->x, rect->y, rect->width, rect->height, 0, 0));
-    } else if (target) {
-        TVG_CHECK_RETURN_RESULT(shape->appendRect(0, 0, target->width, target->height, 0, 0));
-    } else {
-        return Result::InvalidArguments;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i)), 24);
+        __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i + 4)), 24);
+        __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i + 8)), 24);
+        __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src + i + 12)), 24);
+        __m128i a = _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3));
+        _mm_storeu_si128((__m128i*)(dst + i), a);
     }
+#endif
 
-    return Result::Success;
+    for (; i < count; i++) {
+        dst[i] = src[i] >> 24;
+    }
 }
 
-static Result canvas_set_target(vg_lite_ctx* ctx, vg_lite_buffer_t* target)
+/* Mask values as the alpha of (count) ARGB pixels. */
+static void mask_expand_span(uint32_t* dst, const uint8_t* src, uint32_t count)
 {
-    uint32_t* target_buffer = nullptr;
-
-    /* if target_buffer needs to be changed, finish current drawing */
-    if (ctx->target_buffer && ctx->target_buffer != target->memory) {
-        vg_lite_finish();
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(zero, a);
+        __m128i hi = _mm_unpackhi_epi8(zero, a);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(zero, lo));
+        _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(zero, lo));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpacklo_epi16(zero, hi));
+        _mm_storeu_si128((__m128i*)(dst + i + 12), _mm_unpackhi_epi16(zero, hi));
     }
+#endif
 
-    ctx->target_format = target->format;
-
-    if (TVG_IS_VG_FMT_SUPPORT(target->format)) {
-        /* if target format is supported by VG, use target buffer directly */
-        target_buffer = (uint32_t*)target->memory;
-        ctx->target_buffer = nullptr;
-        ctx->target_px_size = 0;
-    } else {
-        /* if target format is not supported by VG, use internal buffer */
-        target_buffer = ctx->get_temp_target_buffer(target->width, target->height);
-        ctx->target_buffer = target->memory;
-        ctx->target_px_size = target->width * target->height;
+    for (; i < count; i++) {
+        dst[i] = (uint32_t)src[i] << 24;
     }
+}
 
-    Result res = ctx->canvas->target(
-        target_buffer,
-        target->width,
-        target->width,
-        target->height,
-        SwCanvas::ARGB8888);
-
-    return res;
+/* 256 entry table of the color channels for (conversion), the sRGB transfer
+ * function and its inverse rounded to 8 bits.
+ */
+static void picture_gamma_table(uint8_t table[256], vg_lite_gamma_conversion_t conversion)
+{
+    for (int i = 0; i < 256; i++) {
+        float v = i / 255.0f;
+        switch (conversion) {
+        case VG_LITE_GAMMA_LINEAR:
+            v = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+            break;
+        case VG_LITE_GAMMA_NON_LINEAR:
+            v = v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+            break;
+        default:
+            break;
+        }
+        table[i] = (uint8_t)lroundf(CLAMP(v, 0.0f, 1.0f) * 255.0f);
+    }
 }
 
-static uint32_t width_to_stride(uint32_t w, vg_lite_buffer_format_t color_format)
+/* Rebuild the gamma tables of (ctx) after its gamma or linear blend changed. */
+static void picture_gamma_update(vg_lite_ctx* ctx)
 {
-    if (vg_lite_query_feature(gcFEATURE_BIT_VG_16PIXELS_ALIGN)) {
-        w = VG_LITE_ALIGN(w, 16);
+    uint8_t image[256];
+    uint8_t paint[256];
+    uint8_t resolve[256];
+
+    picture_gamma_table(image, ctx->gamma);
+    if (!ctx->linear_blend) {
+        ctx->set_gamma_tables(ctx->gamma != VG_LITE_GAMMA_NO_CONVERSION ? image : nullptr, nullptr, nullptr);
+        return;
     }
 
-    uint32_t mul, div, align;
-    get_format_bytes(color_format, &mul, &div, &align);
-    return VG_LITE_ALIGN((w * mul / div), align);
+    /* images are converted as asked for, and then taken into linear light like the paint colors */
+    picture_gamma_table(paint, VG_LITE_GAMMA_LINEAR);
+    picture_gamma_table(resolve, VG_LITE_GAMMA_NON_LINEAR);
+    for (int i = 0; i < 256; i++) {
+        image[i] = paint[image[i]];
+    }
+    ctx->set_gamma_tables(image, paint, resolve);
 }
 
-static bool decode_indexed_line(
-    vg_lite_buffer_format_t color_format,
-    const uint32_t* palette,
-    int32_t x, int32_t y,
-    int32_t w_px, const uint8_t* in, uint32_t* out)
+/* Copy (count) premultiplied ARGB pixels with their color channels through
+ * (table), alpha stays. (dst) may be (src).
+ */
+static void picture_gamma_span(uint32_t* dst, const uint32_t* src, uint32_t count, const uint8_t* table)
 {
-    uint8_t px_size;
-    uint16_t mask;
-
-    uint32_t w_byte = width_to_stride(w_px, color_format);
+    /* SSE2 has no byte shuffle to look up tables with, the table stays in L1 */
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t c = src[i];
+        uint32_t a = A(c);
+        if (a == 255) {
+            dst[i] = (c & 0xFF000000) | ((uint32_t)table[R(c)] << 16) | ((uint32_t)table[G(c)] << 8) | table[B(c)];
+        } else if (a == 0) {
+            dst[i] = c;
+        } else {
+            /* the table applies to straight colors */
+            uint32_t r = table[(R(c) * 255 + a / 2) / a];
+            uint32_t g = table[(G(c) * 255 + a / 2) / a];
+            uint32_t b = table[(B(c) * 255 + a / 2) / a];
+            dst[i] = (a << 24) | (UDIV255(r * a) << 16) | (UDIV255(g * a) << 8) | UDIV255(b * a);
+        }
+    }
+}
 
-    in += w_byte * y; /*First pixel*/
-    out += w_px * y;
+/* Premultiply (count) straight ARGB pixels, their color channels through
+ * (table) first when it is set. (dst) may be (src).
+ */
+static void picture_premultiply_span(uint32_t* dst, const uint32_t* src, uint32_t count, const uint8_t* table)
+{
+    uint32_t i = 0;
 
-    int8_t shift = 0;
-    switch (color_format) {
-    case VG_LITE_INDEX_1:
-        px_size = 1;
-        in += x / 8; /*8pixel per byte*/
-        shift = 7 - (x & 0x7);
-        break;
-    case VG_LITE_INDEX_2:
-        px_size = 2;
-        in += x / 4; /*4pixel per byte*/
-        shift = 6 - 2 * (x & 0x3);
-        break;
-    case VG_LITE_INDEX_4:
-        px_size = 4;
-        in += x / 2; /*2pixel per byte*/
-        shift = 4 - 4 * (x & 0x1);
-        break;
-    case VG_LITE_INDEX_8:
-        px_size = 8;
-        in += x;
-        shift = 0;
-        break;
-    default:
-        TVG_ASSERT(false);
-        return false;
+    if (table) {
+        for (; i < count; i++) {
+            uint32_t c = src[i];
+            uint32_t a = A(c);
+            dst[i] = (a << 24) | (UDIV255(table[R(c)] * a) << 16) | (UDIV255(table[G(c)] * a) << 8) | UDIV255(table[B(c)] * a);
+        }
+        return;
     }
 
-    mask = (1 << px_size) - 1; /*E.g. px_size = 2; mask = 0x03*/
+#if defined(__SSE2__)
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 4 <= count; i += 4) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+
+        /* opaque pixels are common and stay */
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(c, opaque), opaque)) != 0xFFFF) {
+            /* each alpha spread over its color bytes, 255 over itself */
+            __m128i a = _mm_srli_epi32(c, 24);
+            a = _mm_or_si128(_mm_or_si128(a, _mm_slli_epi32(a, 8)), _mm_or_si128(_mm_slli_epi32(a, 16), opaque));
+            c = mask_mul_sse2(c, a);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+    }
+#endif
 
-    int32_t i;
-    for (i = 0; i < w_px; i++) {
-        uint8_t val_act = (*in >> shift) & mask;
-        out[i] = palette[val_act];
+    for (; i < count; i++) {
+        uint32_t c = src[i];
+        uint32_t a = A(c);
+        dst[i] = (a << 24) | (UDIV255(R(c) * a) << 16) | (UDIV255(G(c) * a) << 8) | UDIV255(B(c) * a);
+    }
+}
 
-        shift -= px_size;
-        if (shift < 0) {
-            shift = 8 - px_size;
-            in++;
+/* Copy (count) premultiplied ARGB pixels with straight color channels, (dst) may be (src). */
+static void picture_unpremultiply_span(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t c = src[i];
+        uint32_t a = A(c);
+        if (a == 255 || a == 0) {
+            dst[i] = c;
+            continue;
         }
+
+        /* one division per pixel, 16-bit fixed point for the channels */
+        uint32_t scale = (255 * 65536 + a / 2) / a;
+        uint32_t r = (R(c) * scale + 32768) >> 16;
+        uint32_t g = (G(c) * scale + 32768) >> 16;
+        uint32_t b = (B(c) * scale + 32768) >> 16;
+        dst[i] = (a << 24) | ((r > 255 ? 255 : r) << 16) | ((g > 255 ? 255 : g) << 8) | (b > 255 ? 255 : b);
     }
-    return true;
 }
 
-static Result picture_load(vg_lite_ctx* ctx, std::unique_ptr<Picture>& picture, const vg_lite_buffer_t* source, vg_lite_color_t color)
+/* Give (count) premultiplied ARGB pixels the alpha (alpha) in place of their
+ * own, the color channels are premultiplied again.
+ */
+static void picture_global_alpha_span(uint32_t* dst, uint32_t count, uint8_t alpha)
 {
-    uint32_t* image_buffer;
-    TVG_ASSERT(VG_LITE_IS_ALIGNED(source->memory, CONFIG_VG_LITE_TVG_BUF_ADDR_ALIGN));
+    uint32_t v = alpha;
 
-#ifdef CONFIG_VG_LITE_TVG_16PIXELS_ALIGN
-    TVG_ASSERT(VG_LITE_IS_ALIGNED(source->width, 16));
-#endif
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t c = dst[i];
+        uint32_t a = A(c);
+        if (a == 255) {
+            dst[i] = (v << 24) | (UDIV255(R(c) * v) << 16) | (UDIV255(G(c) * v) << 8) | UDIV255(B(c) * v);
+            continue;
+        }
+        if (a == 0) {
+            /* no color left to scale */
+            dst[i] = v << 24;
+            continue;
+        }
 
-    if (source->format == VG_LITE_BGRA8888 && source->image_mode == VG_LITE_NORMAL_IMAGE_MODE) {
-        image_buffer = (uint32_t*)source->memory;
-    } else {
-        uint32_t width = source->width;
-        uint32_t height = source->height;
-        uint32_t px_size = width * height;
-        image_buffer = ctx->get_image_buffer(width, height);
+        /* c / a * v in 16-bit fixed point, one division per pixel */
+        uint32_t scale = (v << 16) / a;
+        uint32_t r = (R(c) * scale + 32768) >> 16;
+        uint32_t g = (G(c) * scale + 32768) >> 16;
+        uint32_t b = (B(c) * scale + 32768) >> 16;
+        dst[i] = (v << 24) | ((r > v ? v : r) << 16) | ((g > v ? v : g) << 8) | (b > v ? v : b);
+    }
+}
 
-        vg_lite_buffer_t target;
-        memset(&target, 0, sizeof(target));
-        target.memory = image_buffer;
-        target.format = VG_LITE_BGRA8888;
-        target.width = width;
-        target.height = height;
-        target.stride = width_to_stride(width, target.format);
+/* Copy (count) ARGB pixels, those matching one of the enabled (keys) take its
+ * alpha. The first matching key wins, (dst) may be (src). With (premultiply)
+ * the pixels are straight, and those no key matches are premultiplied.
+ */
+static void color_key_span(uint32_t* dst, const uint32_t* src, uint32_t count, const vg_lite_color_key_t* keys, bool premultiply)
+{
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    /* the alpha byte of the bounds always matches */
+    __m128i lo[4], hi[4], alpha[4];
+    for (int k = 0; k < 4; k++) {
+        const vg_lite_color_key_t* key = &keys[k];
+        lo[k] = _mm_set1_epi32((int)((key->low_r << 16) | (key->low_g << 8) | key->low_b));
+        hi[k] = _mm_set1_epi32((int)(0xFF000000 | (key->hign_r << 16) | (key->hign_g << 8) | key->hign_b));
+        alpha[k] = _mm_set1_epi8((char)key->alpha);
+    }
 
-        switch (source->format) {
-        case VG_LITE_INDEX_1:
-        case VG_LITE_INDEX_2:
-        case VG_LITE_INDEX_4:
-        case VG_LITE_INDEX_8: {
-            const uint32_t* clut_colors = ctx->get_CLUT(source->format);
-            for (uint32_t y = 0; y < height; y++) {
-                decode_indexed_line(source->format, clut_colors, 0, y, width, (uint8_t*)source->memory, image_buffer);
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+    for (; i + 4 <= count; i += 4) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i out = c;
+        if (premultiply && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(c, opaque), opaque)) != 0xFFFF) {
+            __m128i a = _mm_srli_epi32(c, 24);
+            a = _mm_or_si128(_mm_or_si128(a, _mm_slli_epi32(a, 8)), _mm_or_si128(_mm_slli_epi32(a, 16), opaque));
+            out = mask_mul_sse2(c, a);
+        }
+
+        /* lowest priority first, so key 0 is written last */
+        for (int k = 3; k >= 0; k--) {
+            if (!keys[k].enable) {
+                continue;
             }
-        } break;
+            __m128i in = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(c, lo[k]), c), _mm_cmpeq_epi8(_mm_min_epu8(c, hi[k]), c));
+            __m128i match = _mm_cmpeq_epi32(in, ones);
+            if (_mm_movemask_epi8(match)) {
+                __m128i keyed = mask_mul_sse2(_mm_or_si128(c, opaque), alpha[k]);
+                out = _mm_or_si128(_mm_and_si128(match, keyed), _mm_andnot_si128(match, out));
+            }
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+#endif
 
-        case VG_LITE_A4: {
-            conv_alpha4_to_bgra8888.convert(&target, source, color);
-        } break;
+    for (; i < count; i++) {
+        uint32_t c = src[i];
+        uint32_t a = A(c);
+        bool scale = premultiply && a != 255;
+        for (int k = 0; k < 4; k++) {
+            const vg_lite_color_key_t* key = &keys[k];
+            if (key->enable
+                && R(c) >= key->low_r && R(c) <= key->hign_r
+                && G(c) >= key->low_g && G(c) <= key->hign_g
+                && B(c) >= key->low_b && B(c) <= key->hign_b) {
+                /* premultiplied by the key alpha */
+                a = key->alpha;
+                scale = true;
+                break;
+            }
+        }
+        if (scale) {
+            c = (a << 24) | (UDIV255(R(c) * a) << 16) | (UDIV255(G(c) * a) << 8) | UDIV255(B(c) * a);
+        }
+        dst[i] = c;
+    }
+}
 
-        case VG_LITE_A8: {
-            conv_alpha8_to_bgra8888.convert(&target, source, color);
-        } break;
+/* Pixel matrix row (m) applied to premultiplied inputs of alpha (a), the result
+ * is premultiplied by (a1).
+ */
+static inline uint32_t pixel_matrix_premultiplied(const int16_t m[5], uint32_t a, uint32_t r, uint32_t g, uint32_t b, uint32_t a1)
+{
+    /* the alpha column sees a * a and the offset a, both premultiplied */
+    int32_t v = (m[0] * (int32_t)UDIV255(a * a) + m[1] * (int32_t)r + m[2] * (int32_t)g + m[3] * (int32_t)b
+                    + m[4] * (int32_t)a + 2048)
+        >> 12;
+    return (uint32_t)CLAMP(v, 0, (int32_t)a1);
+}
 
-        case VG_LITE_BGRX8888: {
-            conv_bgrx8888_to_bgra8888.convert(&target, source);
-        } break;
+/* Pixel matrix row (m) applied to straight inputs. */
+static inline uint32_t pixel_matrix_straight(const int16_t m[5], uint32_t a, uint32_t r, uint32_t g, uint32_t b)
+{
+    int32_t v = (m[0] * (int32_t)a + m[1] * (int32_t)r + m[2] * (int32_t)g + m[3] * (int32_t)b + m[4] * 255 + 2048) >> 12;
+    return (uint32_t)CLAMP(v, 0, 255);
+}
 
-        case VG_LITE_BGR888: {
-            conv_bgr888_to_bgra8888.convert(&target, source);
-        } break;
+/* Quantize the A, R, G, B rows (m) of a pixel matrix, leaving out the rows not
+ * in (enable) and identity rows. (active) tells if any row is left, false if a
+ * coefficient is out of range.
+ */
+static bool pixel_matrix_build(pixel_matrix_t* matrix, const vg_lite_float_t m[20], const bool enable[4], bool* active)
+{
+    memset(matrix, 0, sizeof(pixel_matrix_t));
+    *active = false;
+
+    for (int row = 0; row < 4; row++) {
+        bool identity = true;
+        for (int col = 0; col < 5; col++) {
+            /* 4.12 fixed point, values just below 8 still round out of int16 */
+            vg_lite_float_t value = m[row * 5 + col];
+            if (!(fabsf(value) < 8.0f)) {
+                return false;
+            }
+            long fixed = lroundf(value * 4096);
+            if (fixed > 32767 || fixed < -32767) {
+                return false;
+            }
+            matrix->m[row][col] = (int16_t)fixed;
+            identity &= matrix->m[row][col] == (col == row ? 4096 : 0);
+        }
+        matrix->enable[row] = enable[row] && !identity;
+        *active |= matrix->enable[row];
+    }
 
-        case VG_LITE_BGRA5658: {
-            conv_bgra5658_to_bgra8888.convert(&target, source);
-        } break;
+    matrix->premultiplied = !matrix->enable[0];
 
-        case VG_LITE_BGR565: {
-            conv_bgr565_to_bgra8888.convert(&target, source);
-        } break;
+    /* an alpha row that only scales down folds into the color rows */
+    vg_lite_float_t scale = m[0];
+    if (matrix->enable[0] && m[1] == 0 && m[2] == 0 && m[3] == 0 && m[4] == 0 && scale >= 0 && scale <= 1) {
+        matrix->premultiplied = true;
+        for (int row = 1; row < 4; row++) {
+            for (int col = 0; col < 5; col++) {
+                vg_lite_float_t value = matrix->enable[row] ? m[row * 5 + col] : (col == row ? 1.0f : 0.0f);
+                matrix->m[row][col] = (int16_t)lroundf(value * scale * 4096);
+            }
+            matrix->enable[row] = true;
+        }
+    }
 
-#ifdef CONFIG_VG_LITE_TVG_YUV_SUPPORT
-        case VG_LITE_NV12: {
-            libyuv::NV12ToARGB((const uint8_t*)source->memory, source->stride, (const uint8_t*)source->yuv.uv_memory, source->yuv.uv_stride,
-                (uint8_t*)image_buffer, source->width * sizeof(uint32_t), width, height);
-        } break;
-#endif
+    return true;
+}
 
-        case VG_LITE_BGRA8888: {
-            memcpy(image_buffer, source->memory, px_size * sizeof(vg_color32_t));
-        } break;
+/* Transform (count) premultiplied ARGB pixels in place by the enabled rows of (matrix). */
+static void pixel_matrix_span(uint32_t* bits, uint32_t count, const pixel_matrix_t* matrix)
+{
+    const bool* enable = matrix->enable;
+    uint32_t i = 0;
+
+    if (!matrix->premultiplied) {
+        /* a new alpha needs the straight colors */
+        for (; i < count; i++) {
+            uint32_t c = bits[i];
+            uint32_t a = A(c), r = 0, g = 0, b = 0;
+            if (a) {
+                r = MIN((R(c) * 255 + a / 2) / a, 255U);
+                g = MIN((G(c) * 255 + a / 2) / a, 255U);
+                b = MIN((B(c) * 255 + a / 2) / a, 255U);
+            }
 
-        default:
-            TVG_LOG("unsupport format: %d\n", source->format);
-            TVG_ASSERT(false);
-            break;
+            uint32_t a1 = enable[0] ? pixel_matrix_straight(matrix->m[0], a, r, g, b) : a;
+            uint32_t r1 = enable[1] ? pixel_matrix_straight(matrix->m[1], a, r, g, b) : r;
+            uint32_t g1 = enable[2] ? pixel_matrix_straight(matrix->m[2], a, r, g, b) : g;
+            uint32_t b1 = enable[3] ? pixel_matrix_straight(matrix->m[3], a, r, g, b) : b;
+            bits[i] = (a1 << 24) | (UDIV255(r1 * a1) << 16) | (UDIV255(g1 * a1) << 8) | UDIV255(b1 * a1);
         }
+        return;
+    }
 
-        /* multiply color */
-        if (source->image_mode == VG_LITE_MULTIPLY_IMAGE_MODE && !VG_LITE_IS_ALPHA_FORMAT(source->format)) {
-            vg_color32_t* dest = (vg_color32_t*)image_buffer;
-            while (px_size--) {
-                dest->alpha = UDIV255(dest->alpha * A(color));
-                dest->red = UDIV255(dest->red * B(color));
-                dest->green = UDIV255(dest->green * G(color));
-                dest->blue = UDIV255(dest->blue * R(color));
-                dest++;
+#if defined(__SSE2__)
+    /* coefficient pairs for _mm_madd_epi16() over the interleaved channels,
+     * the offset pairs with a lane of 1 that also carries the rounding
+     */
+    __m128i coef_bg[4], coef_ra[4], coef_ao[4];
+    coef_ao[0] = _mm_set1_epi32((int)((2048U << 16) | (uint16_t)matrix->m[0][0]));
+    for (int row = 1; row < 4; row++) {
+        const int16_t* m = matrix->m[row];
+        coef_bg[row] = _mm_set1_epi32((int)(((uint32_t)(uint16_t)m[2] << 16) | (uint16_t)m[3]));
+        coef_ra[row] = _mm_set1_epi32((int)(((uint32_t)(uint16_t)m[0] << 16) | (uint16_t)m[1]));
+        coef_ao[row] = _mm_set1_epi32((int)((2048U << 16) | (uint16_t)m[4]));
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i div = _mm_set1_epi16((short)0x8081);
+    for (; i + 8 <= count; i += 8) {
+        __m128i p0 = _mm_loadu_si128((const __m128i*)(bits + i));
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(bits + i + 4));
+
+        /* eight pixels per channel in 16-bit lanes */
+        __m128i ch[4];
+        ch[3] = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+        ch[2] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+        ch[1] = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+        ch[0] = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+        __m128i a2 = _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(ch[0], ch[0]), div), 7);
+
+        __m128i bg_lo = _mm_unpacklo_epi16(ch[3], ch[2]), bg_hi = _mm_unpackhi_epi16(ch[3], ch[2]);
+        __m128i ra_lo = _mm_unpacklo_epi16(ch[1], a2), ra_hi = _mm_unpackhi_epi16(ch[1], a2);
+        __m128i ao_lo = _mm_unpacklo_epi16(ch[0], one), ao_hi = _mm_unpackhi_epi16(ch[0], one);
+
+        __m128i out[4];
+        out[0] = ch[0];
+        if (enable[0]) {
+            /* scaled down, never above the old alpha */
+            __m128i lo = _mm_srai_epi32(_mm_madd_epi16(ao_lo, coef_ao[0]), 12);
+            __m128i hi = _mm_srai_epi32(_mm_madd_epi16(ao_hi, coef_ao[0]), 12);
+            out[0] = _mm_packs_epi32(lo, hi);
+        }
+        for (int row = 1; row < 4; row++) {
+            if (!enable[row]) {
+                out[row] = ch[row];
+                continue;
             }
+            __m128i lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(bg_lo, coef_bg[row]), _mm_madd_epi16(ra_lo, coef_ra[row])),
+                _mm_madd_epi16(ao_lo, coef_ao[row]));
+            __m128i hi = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(bg_hi, coef_bg[row]), _mm_madd_epi16(ra_hi, coef_ra[row])),
+                _mm_madd_epi16(ao_hi, coef_ao[row]));
+            __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, 12), _mm_srai_epi32(hi, 12));
+            out[row] = _mm_min_epi16(_mm_max_epi16(v, zero), out[0]);
         }
-    }
 
-    TVG_CHECK_RETURN_RESULT(picture->load(image_buffer, source->width, source->height, true));
+        __m128i bg = _mm_or_si128(out[3], _mm_slli_epi16(out[2], 8));
+        __m128i ra = _mm_or_si128(out[1], _mm_slli_epi16(out[0], 8));
+        _mm_storeu_si128((__m128i*)(bits + i), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i*)(bits + i + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+#endif
 
-    return Result::Success;
+    for (; i < count; i++) {
+        uint32_t c = bits[i];
+        uint32_t a = A(c), r = R(c), g = G(c), b = B(c);
+        uint32_t a1 = enable[0] ? (uint32_t)((matrix->m[0][0] * (int32_t)a + 2048) >> 12) : a;
+        uint32_t r1 = enable[1] ? pixel_matrix_premultiplied(matrix->m[1], a, r, g, b, a1) : r;
+        uint32_t g1 = enable[2] ? pixel_matrix_premultiplied(matrix->m[2], a, r, g, b, a1) : g;
+        uint32_t b1 = enable[3] ? pixel_matrix_premultiplied(matrix->m[3], a, r, g, b, a1) : b;
+        bits[i] = (a1 << 24) | (r1 << 16) | (g1 << 8) | b1;
+    }
 }
 
 static void ClampColor(FLOATVECTOR4 Source, FLOATVECTOR4 Target, uint8_t Premultiplied)
@@ -0,0 +1,171 @@
+/**
+ * @file vg_lite_tvg.h
+ *
+ */
+
+#ifndef VG_LITE_TVG_H
+#define VG_LITE_TVG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "vg_lite.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define VG_LITE_TVG_PATH_PACK_MAGIC     0x50565456  /*! "VTVP" */
+#define VG_LITE_TVG_PATH_PACK_VERSION   1
+
+/* Path pack commands, same values as tvg::PathCommand. */
+#define VG_LITE_TVG_PATH_CMD_CLOSE      0           /*! No point. */
+#define VG_LITE_TVG_PATH_CMD_MOVE       1           /*! 1 point. */
+#define VG_LITE_TVG_PATH_CMD_LINE       2           /*! 1 point. */
+#define VG_LITE_TVG_PATH_CMD_CUBIC      3           /*! 3 points: 2 control points and the end point. */
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Path pack: pre-parsed paths that can be mapped and drawn without parsing.
+ *
+ * The file is laid out in host byte order as
+ *
+ *      vg_lite_tvg_path_pack_header_t
+ *      vg_lite_tvg_path_pack_entry_t[path_count]
+ *      command (uint8) and point (float x, y) arrays, point arrays 4-byte aligned
+ *
+ * and is produced from VLC path data by tools/vg_lite_path_pack.c.
+ */
+typedef struct vg_lite_tvg_path_pack_header {
+    vg_lite_uint32_t magic;                 /*! VG_LITE_TVG_PATH_PACK_MAGIC. */
+    vg_lite_uint32_t version;               /*! VG_LITE_TVG_PATH_PACK_VERSION. */
+    vg_lite_uint32_t path_count;            /*! Number of entries. */
+    vg_lite_uint32_t size;                  /*! Size of the whole pack in bytes. */
+} vg_lite_tvg_path_pack_header_t;
+
+typedef struct vg_lite_tvg_path_pack_entry {
+    vg_lite_float_t bounding_box[4];        /*! Bounding box of the source path: left, top, right, bottom. */
+    vg_lite_float_t bounds[4];              /*! Bounds of all points: left, top, right, bottom. */
+    vg_lite_uint32_t fill_rule;             /*! vg_lite_fill_t of the source path. */
+    vg_lite_uint32_t cmd_count;             /*! Number of commands. */
+    vg_lite_uint32_t cmd_offset;            /*! Offset of the command array from the pack start. */
+    vg_lite_uint32_t pt_count;              /*! Number of points. */
+    vg_lite_uint32_t pt_offset;             /*! Offset of the point array from the pack start. */
+    vg_lite_uint32_t reserved;
+} vg_lite_tvg_path_pack_entry_t;
+
+/* An opened path pack. */
+typedef struct vg_lite_tvg_path_pack {
+    const vg_lite_tvg_path_pack_header_t *header;
+    const vg_lite_tvg_path_pack_entry_t *entries;
+    vg_lite_uint32_t size;                  /*! Size of the pack in bytes. */
+    vg_lite_uint32_t map_size;              /*! Size of the mapping, 0 if not mapped by vg_lite_tvg_path_pack_map(). */
+} vg_lite_tvg_path_pack_t;
+
+/* Class of a vg_lite_matrix_t, each one a special case of the next. */
+typedef enum vg_lite_tvg_matrix_type {
+    VG_LITE_TVG_MATRIX_IDENTITY,            /*! No transformation. */
+    VG_LITE_TVG_MATRIX_TRANSLATE,           /*! Translation only. */
+    VG_LITE_TVG_MATRIX_SCALE,               /*! Scale and translation, axes stay aligned. */
+    VG_LITE_TVG_MATRIX_AFFINE,              /*! Rotation or skew, bottom row is (0, 0, 1). */
+    VG_LITE_TVG_MATRIX_PERSPECTIVE,         /*! Projective. */
+} vg_lite_tvg_matrix_type_t;
+
+/* Turn of the canvas onto the target, see vg_lite_tvg_set_rotation(). */
+typedef enum vg_lite_tvg_rotation {
+    VG_LITE_TVG_ROTATION_0,                 /*! Canvas and target are the same. */
+    VG_LITE_TVG_ROTATION_90,                /*! Canvas turned 90 degrees clockwise onto the target. */
+    VG_LITE_TVG_ROTATION_180,               /*! Canvas turned 180 degrees. */
+    VG_LITE_TVG_ROTATION_270,               /*! Canvas turned 270 degrees clockwise onto the target. */
+} vg_lite_tvg_rotation_t;
+
+/* Statistics of the ThorVG backend, counted since the last reset. */
+typedef struct vg_lite_tvg_stats {
+    vg_lite_uint32_t draw_merged;           /*! vg_lite_draw() calls merged into the previous shape. */
+    vg_lite_uint32_t grad_cache_hit;        /*! Gradient updates that reused an identical color ramp image. */
+    vg_lite_uint32_t grad_cache_miss;       /*! Gradient updates that had to build a color ramp image. */
+    vg_lite_uint32_t draw_culled;           /*! Draws skipped for lying outside of the target. */
+    vg_lite_uint32_t blur_cache_hit;        /*! Gaussian filtered images reused from an earlier draw. */
+    vg_lite_uint32_t blur_cache_miss;       /*! Gaussian filtered images that had to be filtered. */
+    vg_lite_uint32_t image_cache_hit;       /*! Color keyed or transformed images reused from an earlier draw. */
+    vg_lite_uint32_t image_cache_miss;      /*! Color keyed or transformed images that had to be decoded. */
+} vg_lite_tvg_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/* Open a path pack already in memory. All entries are validated here, (data) must stay valid while the pack is used. */
+vg_lite_error_t vg_lite_tvg_path_pack_open(vg_lite_tvg_path_pack_t *pack, const void *data, vg_lite_uint32_t size);
+
+/* Map a path pack file read-only and open it. */
+vg_lite_error_t vg_lite_tvg_path_pack_map(vg_lite_tvg_path_pack_t *pack, const char *filename);
+
+/* Unmap a path pack opened by vg_lite_tvg_path_pack_map(). */
+vg_lite_error_t vg_lite_tvg_path_pack_unmap(vg_lite_tvg_path_pack_t *pack);
+
+/* Set up (path) to draw entry (index) of the pack, optionally returning the fill rule stored with it.
+ * The path references the pack memory directly and can be passed to every draw call.
+ */
+vg_lite_error_t vg_lite_tvg_path_pack_get_path(const vg_lite_tvg_path_pack_t *pack,
+                                    vg_lite_uint32_t index,
+                                    vg_lite_path_t *path,
+                                    vg_lite_fill_t *fill_rule);
+
+/* Classify a matrix. Entries are compared exactly, a matrix built by vg_lite_identity(),
+ * vg_lite_translate() and vg_lite_scale() keeps its class.
+ */
+vg_lite_tvg_matrix_type_t vg_lite_tvg_matrix_classify(const vg_lite_matrix_t *matrix);
+
+/* Multiply (matrix) by (mult) in place, like vg_lite_translate() and friends do. */
+vg_lite_error_t vg_lite_tvg_matrix_multiply(vg_lite_matrix_t *matrix, const vg_lite_matrix_t *mult);
+
+/* Transform (count) points, stored as x, y pairs, by (matrix), dividing by w when it is projective.
+ * (src) and (dst) may be the same array.
+ */
+vg_lite_error_t vg_lite_tvg_transform_points(const vg_lite_matrix_t *matrix,
+                                    const vg_lite_float_t *src,
+                                    vg_lite_float_t *dst,
+                                    vg_lite_uint32_t count);
+
+/* Parse (path) once and bake (matrix) into its points. (baked) is set up like a path pack path
+ * holding device coordinates, so drawing it with an identity matrix skips parsing and transformation.
+ * A path that leaves its bounding box can only be baked with a scale and translate matrix.
+ */
+vg_lite_error_t vg_lite_tvg_path_bake(const vg_lite_path_t *path, const vg_lite_matrix_t *matrix, vg_lite_path_t *baked);
+
+/* Free the points of a path set up by vg_lite_tvg_path_bake(), any other path is rejected with VG_LITE_INVALID_ARGUMENT. */
+vg_lite_error_t vg_lite_tvg_path_bake_free(vg_lite_path_t *baked);
+
+/* Draw into targets turned by (rotation), e.g. a portrait UI on a landscape panel. Paints use the
+ * coordinates of the canvas, which is the target with its width and height swapped for 90 and 270
+ * degrees, and vg_lite_finish() turns the canvas while resolving it into the target.
+ */
+vg_lite_error_t vg_lite_tvg_set_rotation(vg_lite_tvg_rotation_t rotation);
+
+/* Blend in linear light when (enable) is set. Paint colors, gradient stops and images are taken
+ * from sRGB into linear light before drawing, and vg_lite_finish() takes the canvas back to sRGB
+ * while resolving it into the target. The canvas keeps 8 bits per channel, so sRGB levels 0 to
+ * 17 collapse to two values and dark tones band. Returns VG_LITE_NOT_SUPPORT unless
+ * CONFIG_VG_LITE_TVG_LINEAR_BLEND is set.
+ */
+vg_lite_error_t vg_lite_tvg_set_linear_blend(vg_lite_uint8_t enable);
+
+/* Get the backend statistics. */
+vg_lite_error_t vg_lite_tvg_get_stats(vg_lite_tvg_stats_t *stats);
+
+/* Reset the backend statistics. */
+vg_lite_error_t vg_lite_tvg_reset_stats(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* VG_LITE_TVG_H */